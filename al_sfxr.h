@@ -36,6 +36,26 @@ this file:
     * `al_sfxr_produce1f`: 44100 Hz, 32-bit float mono
     * `al_sfxr_produce2f`: 44100 Hz, 32-bit float stereo
 
+  Use `al_sfxr_start_rate` or `al_sfxr_compile_rate` to produce frames at
+  other sample rates, and `al_sfxr_start_ex` or `al_sfxr_compile_ex` to also
+  trade quality for speed with a lower oversampling factor.
+* `AL_SFXR_BATCH`: enables `al_sfxr_DecoderBatch`, which renders 4 voices at
+  once using SSE2, or 8 voices when compiled with AVX2.
+* `AL_SFXR_NO_SIMD`: disables the use of SIMD instructions, falling back to
+  portable C code.
+* `AL_SFXR_CACHE`: enables `al_sfxr_Cache`, which renders sounds once and
+  keeps their frames under a memory budget, evicting the least recently used
+  ones. Define `AL_SFXR_MALLOC` and `AL_SFXR_FREE` to replace `malloc` and
+  `free`.
+* `AL_SFXR_MIXER`: enables `al_sfxr_Mixer`, which plays many voices at once
+  from a fixed pool, with per-voice gain and voice stealing, and
+  `al_sfxr_Queue`, a lock-free queue used to send commands to a mixer that is
+  rendered in the audio thread.
+* `AL_SFXR_PROFILE`: counts the frames, noise refills, repeats, and
+  frequency limit endings of each voice, and times the rendering stages of one
+  frame in `AL_SFXR_PROFILE_PERIOD`, 64 by default. Use `al_sfxr_get_profile`
+  or `al_sfxr_voice_get_profile` to read them.
+
 ## Sample code
 
 ```cpp
@@ -74,6 +94,25 @@ while (1) {
     // sound buffer
     mix(samples, samples_written);
 }
+
+// Voices playing the same sound can share a patch, which is compiled only once,
+// and take phaser delay lines from a pool only when the patch needs them
+al_sfxr_Patch patch;
+al_sfxr_compile(&patch, &params);
+
+static al_sfxr_PhaserLine lines[16];
+al_sfxr_PhaserPool pool;
+al_sfxr_pool_init(&pool, lines, 16);
+
+al_sfxr_Voice voices[16];
+
+for (int i = 0; i < 16; i++) {
+    al_sfxr_voice_start(&voices[i], &patch, i, &pool);
+}
+
+// Produce 44100 Hz mono 32-bit float frames for each voice
+float frames[1024];
+size_t const frames_written = al_sfxr_voice_produce(&voices[0], frames, 1024);
 ```
 
 ## License
@@ -158,6 +197,37 @@ typedef struct {
 }
 al_sfxr_Params;
 
+/**
+ * Rendering modes that trade the exact output of the original sfxr for speed
+ * or quality. The default mode, 0, renders exactly what sfxr renders. Modes
+ * can be ORed together.
+ */
+typedef enum {
+    /* Replaces the calls to sin in the sine wave and in the vibrato with a
+       polynomial. The maximum absolute error is 8e-7 for the sine wave, and
+       3e-4 for the vibrato, where the phase loses precision as it grows */
+    AL_SFXR_MODE_FAST_TRIG = 1 << 0,
+    /* Renders square and sawtooth waves with PolyBLEP oscillators, which
+       smooth the jumps of the wave to reduce aliasing, and with a fractional
+       period that follows the exact pitch instead of a whole number of
+       sub-samples. It has better alias rejection at 1x oversampling than the
+       default mode at 8x, and is still faster, see al_sfxr_start_ex */
+    AL_SFXR_MODE_BANDLIMITED = 1 << 1,
+    /* Refills the noise buffer with hashes of one PRNG output computed with
+       SIMD instructions, instead of calling the PRNG once for every entry.
+       The noise is different from sfxr's, but it's still the same for a
+       seed, with or without SIMD */
+    AL_SFXR_MODE_FAST_NOISE = 1 << 2,
+    /* Sets the flush-to-zero and denormals-are-zero flags of the FPU while
+       the voice renders, and restores them afterwards. Filter states that
+       decay towards zero, like the ones of a low-pass sweep that closes
+       during a long decay, become zero instead of going through subnormal
+       floats, which are very slow on x86. Only supported on x86 with SSE and
+       on AArch64 */
+    AL_SFXR_MODE_FLUSH_DENORMALS = 1 << 3
+}
+al_sfxr_Mode;
+
 /**
  * A Newlib LCG pseudo-random number generator.
  *
@@ -169,47 +239,190 @@ typedef struct {
 al_sfxr_Prng;
 
 /**
- * A decoder to generate audio frames from SFXR parameters.
+ * A SFXR compiled into the values that the synthesis derives from its
+ * parameters. A patch is never changed by the voices that play it, so a
+ * single patch can be shared by any number of voices.
+ *
+ * @see al_sfxr_compile
  */
 typedef struct {
-    al_sfxr_Params params;
-    al_sfxr_Prng prng;
+    /* Read for every frame */
+    double fmaxperiod;
+    double fdslide;
+    float square_slide;
+    int env_length[3];
+    float env_punch;
+    float fdphase;
+    float fltw_d;
+    float fltw_max;
+    float fltdmp;
+    float flthp_d;
+    float flthp_min;
+    float flthp_max;
+    float vib_speed;
+    float vib_amp;
+    float volume;
+    int freq_limit;
+    int rep_limit;
+    int min_period;
 
-    int playing_sample;
-    int phase;
+    /* Read when voices start or repeat */
+    al_sfxr_Wave wave_type;
+    int lpf_on;
+    int phaser_on;
+    int oversampling;
     double fperiod;
-    double fmaxperiod;
     double fslide;
-    double fdslide;
+    double arp_mod;
+    int arp_limit;
     int period;
     float square_duty;
-    float square_slide;
-    int env_stage;
-    int env_time;
-    int env_length[3];
-    float env_vol;
     float fphase;
-    float fdphase;
     int iphase;
-    float phaser_buffer[1024];
+    float fltw;
+    float flthp;
+}
+al_sfxr_Patch;
+
+/**
+ * The number of samples in the delay line of the phaser.
+ */
+#define AL_SFXR_PHASER_SIZE 1024
+
+/**
+ * A phaser delay line, linked to the other free lines while in a pool.
+ */
+typedef union al_sfxr_PhaserLine {
+    float samples[AL_SFXR_PHASER_SIZE];
+    union al_sfxr_PhaserLine* next;
+}
+al_sfxr_PhaserLine;
+
+/**
+ * A pool of phaser delay lines provided by the caller. Only voices playing
+ * patches that use the phaser take a line from the pool.
+ *
+ * @see al_sfxr_pool_init
+ */
+typedef struct {
+    al_sfxr_PhaserLine* free;
+}
+al_sfxr_PhaserPool;
+
+#if defined(AL_SFXR_PROFILE)
+#if !defined(AL_SFXR_PROFILE_PERIOD)
+#define AL_SFXR_PROFILE_PERIOD 64
+#endif
+
+/**
+ * The stages of the rendering of a frame, which index the cycle counts of
+ * al_sfxr_Profile.
+ */
+typedef enum {
+    /* Frequency slide, vibrato, square duty, envelope, and phaser offset */
+    AL_SFXR_STAGE_FRAME,
+    /* Phase, noise refills, and base waveform */
+    AL_SFXR_STAGE_OSCILLATOR,
+    AL_SFXR_STAGE_LPF,
+    AL_SFXR_STAGE_HPF,
+    AL_SFXR_STAGE_PHASER,
+    /* Envelope, decimation, volume, and clamping */
+    AL_SFXR_STAGE_OUTPUT,
+
+    AL_SFXR_STAGE_COUNT
+}
+al_sfxr_Stage;
+
+/**
+ * Counters of a voice since it was started. One frame in
+ * AL_SFXR_PROFILE_PERIOD is timed stage by stage with the time stamp counter
+ * on x86, and with the virtual counter on AArch64, whose ticks are usually
+ * longer than a cycle. Cycles are always 0 on other platforms. Reading the
+ * counter takes time too, which is added to every stage of every sub-sample,
+ * so compare the cycles of a stage between runs rather than between stages.
+ */
+typedef struct {
+    /* Frames rendered */
+    uint64_t frames;
+    /* Noise buffer refills, one per period of noise waves */
+    uint64_t noise_refills;
+    /* Restarts of the sound by the repeat speed parameter */
+    uint64_t repeats;
+    /* Sounds that ended early because the frequency slid under the limit */
+    uint64_t frequency_limits;
+    /* Frames timed, and the time spent in each stage for them */
+    uint64_t sampled_frames;
+    uint64_t cycles[AL_SFXR_STAGE_COUNT];
+}
+al_sfxr_Profile;
+#endif /* AL_SFXR_PROFILE */
+
+/**
+ * The steps in a sub-sample used by the phase and period of voices that render
+ * square and sawtooth waves in AL_SFXR_MODE_BANDLIMITED.
+ */
+#define AL_SFXR_BLEP_STEPS 256
+
+/**
+ * A playing instance of a patch. It only holds the state that changes while
+ * the sound plays, and references the patch that must outlive it. The fields
+ * used for every sample come first.
+ *
+ * @see al_sfxr_voice_start
+ */
+typedef struct {
+    al_sfxr_Patch const* patch;
+    float* phaser_buffer;
+    /* In sub-samples, or in AL_SFXR_BLEP_STEPS of a sub-sample for
+       band-limited waves */
+    int phase;
+    int period;
     int ipp;
-    float noise_buffer[32];
+    int iphase;
+    float square_duty;
+    float env_vol;
     float fltp;
     float fltdp;
     float fltw;
-    float fltw_d;
-    float fltdmp;
     float fltphp;
     float flthp;
-    float flthp_d;
+    float decimation;
+
+    double fperiod;
+    double fslide;
     float vib_phase;
-    float vib_speed;
-    float vib_amp;
+    float fphase;
+    int env_stage;
+    int env_time;
     int rep_time;
-    int rep_limit;
     int arp_time;
     int arp_limit;
-    double arp_mod;
+    int playing_sample;
+
+    /* The rendering kernel selected when the voice was started or its mode
+       was changed, 0 is the generic kernel that works for all waves and
+       settings */
+    int kernel;
+    unsigned mode;
+
+    al_sfxr_Prng prng;
+    float noise_buffer[32];
+
+#if defined(AL_SFXR_PROFILE)
+    al_sfxr_Profile profile;
+#endif
+}
+al_sfxr_Voice;
+
+/**
+ * A decoder to generate audio frames from SFXR parameters. It's a voice that
+ * owns its patch and its phaser delay line, so it can be used without
+ * managing patches and pools.
+ */
+typedef struct {
+    al_sfxr_Voice voice;
+    al_sfxr_Patch patch;
+    float phaser_buffer[AL_SFXR_PHASER_SIZE];
 }
 al_sfxr_Decoder;
 
@@ -265,8 +478,43 @@ typedef int (*al_sfxr_Read8)(void* const userdata, uint8_t* const byte);
  * @return 0 if successful, something else on error
  *
  * @see al_sfxr_save
+ * @see al_sfxr_load_mem
  */
 int al_sfxr_load(al_sfxr_Params* const params, al_sfxr_Read8 const reader, void* const userdata);
+
+/**
+ * Loads a SFXR from a memory buffer with the contents of a SFXR file, version
+ * 100, 101, or 102. The fields are decoded straight from the buffer, without
+ * calling a reader for each byte.
+ *
+ * @param params where the SFXR will be loaded to
+ * @param data the buffer
+ * @param size the size of the buffer, which can be larger than the SFXR
+ *
+ * @return 0 if successful, something else on error
+ *
+ * @see al_sfxr_load
+ * @see al_sfxr_save_mem
+ */
+int al_sfxr_load_mem(al_sfxr_Params* const params, void const* const data, size_t const size);
+
+/**
+ * Loads SFXRs from a memory buffer with the contents of SFXR files, of any
+ * version, one after the other.
+ *
+ * @param params where the SFXRs will be loaded to
+ * @param num_params the maximum number of SFXRs to load
+ * @param data the buffer
+ * @param size the size of the buffer
+ * @param used the number of bytes of the buffer that were loaded, can be NULL
+ *
+ * @return the number of SFXRs loaded, which stops at num_params, at the end
+ *         of the buffer, or at the first SFXR that can't be loaded
+ *
+ * @see al_sfxr_load_mem
+ */
+size_t al_sfxr_load_mem_batch(al_sfxr_Params* const params, size_t const num_params, void const* const data,
+                              size_t const size, size_t* const used);
 #endif /* AL_SFXR_LOAD */
 
 #if defined(AL_SFXR_SAVE)
@@ -293,1072 +541,4914 @@ typedef int (*al_sfxr_Write8)(void* const userdata, uint8_t byte);
  * @return 0 if successful, something else on error
  *
  * @see al_sfxr_load
+ * @see al_sfxr_save_mem
  */
 int al_sfxr_save(al_sfxr_Params const* const params, al_sfxr_Write8 const writer, void* const userdata);
-#endif /* AL_SFXR_SAVE */
 
 /**
- * Starts playing a SFXR. A playing SFXR is called a decoder, and there can be
- * many voices playing concurrently for the same SFXR. The parameters will be
- * copied into the decoder and can be disposed when the function returns. The
- * seed is used to initialize a PRNG to generate noise during play, if needed.
+ * The size of a saved SFXR, which is always version 102.
+ */
+#define AL_SFXR_SAVE_SIZE 105
+
+/**
+ * Saves the SFXR to a memory buffer, in the same format as al_sfxr_save.
+ * Calling it for many SFXRs, advancing the buffer by AL_SFXR_SAVE_SIZE bytes
+ * each time, writes a buffer that al_sfxr_load_mem_batch can load.
  *
- * @param decoder the playing decoder created by the function
- * @param params the SFXR to play
- * @param seed the seed for the PRNG
+ * @param params the SFXR to save
+ * @param data the buffer
+ * @param size the size of the buffer
  *
- * @see al_sfxr_start_quick
- * @see al_sfxr_restart
+ * @return the number of bytes written, AL_SFXR_SAVE_SIZE, or 0 if the buffer
+ *         is too small
+ *
+ * @see al_sfxr_save
+ * @see al_sfxr_load_mem
  */
-void al_sfxr_start(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params, uint64_t const seed);
+size_t al_sfxr_save_mem(al_sfxr_Params const* const params, void* const data, size_t const size);
+#endif /* AL_SFXR_SAVE */
 
+#if defined(AL_SFXR_BANK)
 /**
- * Starts playing a SFXR. The parameters will be copied into the decoder and
- * can be disposed when the function returns. It uses the Newlib LCG with a
- * hardcoded seed.
- *
- * @param decoder the playing decoder created by the function
- * @param params the SFXR to play
+ * The version of the bank format written by al_sfxr_bank_write.
+ */
+#define AL_SFXR_BANK_VERSION 1
+
+/**
+ * An entry of the index of a bank, sorted by id.
+ */
+typedef struct {
+    uint32_t id;
+    uint32_t record;
+}
+al_sfxr_BankEntry;
+
+/**
+ * A bank of SFXRs that lives in memory owned by the application, usually a
+ * memory-mapped file. The bank format is a little-endian 32-byte header, the
+ * little-endian index sorted by id, and the parameters of the sounds in a
+ * record block that starts at a 64-byte boundary, and the records are native
+ * al_sfxr_Params used in place without parsing or copying them.
  *
- * @see al_sfxr_start
- * @see al_sfxr_restart
+ * @see al_sfxr_bank_open
+ * @see al_sfxr_bank_write
  */
-void al_sfxr_start_quick(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params);
+typedef struct {
+    al_sfxr_BankEntry const* index;
+    al_sfxr_Params const* params;
+    uint32_t count;
+}
+al_sfxr_Bank;
 
 /**
- * Restarts a SFXR, leaving the decoder in the same state as it was when one
- * of the start functions was called to create the decoder.
+ * Hashes a sound name into the id used to find it in a bank, with 32-bit
+ * FNV-1a.
  *
- * @param decoder the playing decoder created by the function
- * @param params the SFXR to play
- * @param seed the seed for the PRNG
+ * @param name the name of the sound, i.e. the name of its file without the
+ *        directory and the extension
  *
- * @see al_sfxr_start
- * @see al_sfxr_start_quick
+ * @return the id
  */
-void al_sfxr_restart(al_sfxr_Decoder* const decoder);
+uint32_t al_sfxr_bank_hash(char const* const name);
 
-#if defined(AL_SFXR_INT16_MONO)
 /**
- * Produces num_frames of mono audio into the output buffer. The buffer must
- * have num_frames * 2 bytes available.
+ * Returns the size of a bank with the given number of sounds.
  *
- * @param decoder the decoder from which to generate the audio frames
- * @param frames the output buffer
- * @param num_frames the number of frames to write
+ * @param count the number of sounds
  *
- * @result the number of frames written
+ * @return the size of the bank in bytes
+ */
+size_t al_sfxr_bank_size(size_t const count);
+
+/**
+ * Writes a bank to memory, to be saved to a file and later opened with
+ * al_sfxr_bank_open on a platform with the same al_sfxr_Params layout.
  *
- * @see al_sfxr_produce2i
- * @see al_sfxr_produce1f
- * @see al_sfxr_produce2f
+ * @param data the buffer, with at least al_sfxr_bank_size(count) bytes
+ * @param size the size of the buffer
+ * @param params the sounds
+ * @param ids the id of each sound, usually from al_sfxr_bank_hash
+ * @param count the number of sounds
+ *
+ * @return the number of bytes written, or 0 if the buffer is too small or
+ *         there are duplicated ids
  */
-size_t al_sfxr_produce1i(al_sfxr_Decoder* const decoder, int16_t* frames, size_t const num_frames);
-#endif /* AL_SFXR_INT16_MONO */
+size_t al_sfxr_bank_write(void* const data, size_t const size, al_sfxr_Params const* const params,
+                          uint32_t const* const ids, size_t const count);
 
-#if defined(AL_SFXR_INT16_STEREO)
 /**
- * Produces num_frames of stereo audio into the output buffer. The buffer must
- * have num_frames * 4 bytes available.
+ * Opens a bank in memory, checking its header. The memory must be aligned to
+ * 4 bytes, as the ones returned by mmap and malloc are, and must outlive the
+ * bank. Banks can't be opened on big-endian platforms, or where the layout of
+ * al_sfxr_Params differs from the one where they were written.
  *
- * @param decoder the decoder from which to generate the audio frames
- * @param frames the output buffer
- * @param num_frames the number of frames to write
+ * @param bank the bank
+ * @param data the contents of a bank file
+ * @param size the size of the contents
  *
- * @result the number of frames written
+ * @return 0 if successful, something else on error
+ */
+int al_sfxr_bank_open(al_sfxr_Bank* const bank, void const* const data, size_t const size);
+
+/**
+ * Finds a sound in a bank with a binary search of its index.
  *
- * @see al_sfxr_produce1i
- * @see al_sfxr_produce1f
- * @see al_sfxr_produce2f
+ * @param bank the bank
+ * @param id the id of the sound
+ *
+ * @return the parameters of the sound, pointing into the bank's memory, or
+ *         NULL if the bank doesn't have the id
  */
-size_t al_sfxr_produce2i(al_sfxr_Decoder* const decoder, int16_t* frames, size_t const num_frames);
-#endif /* AL_SFXR_INT16_STEREO */
+al_sfxr_Params const* al_sfxr_bank_find(al_sfxr_Bank const* const bank, uint32_t const id);
 
-#if defined(AL_SFXR_FLOAT_MONO)
+#if defined(AL_SFXR_GENERATE)
 /**
- * Produces num_frames of mono audio into the output buffer. The buffer must
- * have num_frames * 4 bytes available.
+ * The arguments of al_sfxr_generate that describe a sound in a seed bank,
+ * and an optional volume that replaces the generated one.
+ */
+typedef struct {
+    al_sfxr_Preset preset;
+    unsigned mutations;
+    uint64_t seed;
+    /* Replaces the generated sound_vol when it's not negative */
+    float volume;
+}
+al_sfxr_Seed;
+
+/**
+ * A slot of the memoization table of a seed bank, with the parameters of a
+ * sound once they're generated. Slots must be zeroed before use.
+ */
+typedef struct {
+    al_sfxr_Params params;
+    unsigned volatile state;
+}
+al_sfxr_SeedSlot;
+
+/**
+ * A bank of sounds described by the arguments of al_sfxr_generate, in 16
+ * bytes instead of the parameters, which are generated when they're first
+ * needed and memoized. The format is the same as the one of al_sfxr_Bank,
+ * with 16-byte seed records instead of parameters.
  *
- * @param decoder the decoder from which to generate the audio frames
- * @param frames the output buffer
- * @param num_frames the number of frames to write
+ * @see al_sfxr_seedbank_open
+ * @see al_sfxr_seedbank_write
+ */
+typedef struct {
+    al_sfxr_BankEntry const* index;
+    uint8_t const* records;
+    uint32_t count;
+    al_sfxr_SeedSlot* slots;
+}
+al_sfxr_SeedBank;
+
+/**
+ * Returns the size of a seed bank with the given number of sounds.
  *
- * @result the number of frames written
+ * @param count the number of sounds
  *
- * @see al_sfxr_produce1i
- * @see al_sfxr_produce2i
- * @see al_sfxr_produce2f
+ * @return the size of the seed bank in bytes
  */
-size_t al_sfxr_produce1f(al_sfxr_Decoder* const decoder, float* frames, size_t const num_frames);
-#endif /* AL_SFXR_FLOAT_MONO */
+size_t al_sfxr_seedbank_size(size_t const count);
 
-#if defined(AL_SFXR_FLOAT_STEREO)
 /**
- * Produces num_frames of stereo audio into the output buffer. The buffer must
- * have num_frames * 8 bytes available.
+ * Writes a seed bank to memory.
  *
- * @param decoder the decoder from which to generate the audio frames
- * @param frames the output buffer
- * @param num_frames the number of frames to write
+ * @param data the buffer, with at least al_sfxr_seedbank_size(count) bytes
+ * @param size the size of the buffer
+ * @param seeds the sounds
+ * @param ids the id of each sound, usually from al_sfxr_bank_hash
+ * @param count the number of sounds
  *
- * @result the number of frames written
+ * @return the number of bytes written, or 0 if the buffer is too small,
+ *         there are duplicated ids, or a sound has an invalid preset or more
+ *         than 65535 mutations
+ */
+size_t al_sfxr_seedbank_write(void* const data, size_t const size, al_sfxr_Seed const* const seeds,
+                              uint32_t const* const ids, size_t const count);
+
+/**
+ * Opens a seed bank in memory, with the same requirements as
+ * al_sfxr_bank_open. The bank doesn't memoize the parameters until it's
+ * given a table with al_sfxr_seedbank_memoize.
  *
- * @see al_sfxr_produce1i
- * @see al_sfxr_produce2i
- * @see al_sfxr_produce1f
+ * @param bank the seed bank
+ * @param data the contents of a seed bank file
+ * @param size the size of the contents
+ *
+ * @return 0 if successful, something else on error, including records with
+ *         an invalid preset, unknown flags, or a negative volume
  */
-size_t al_sfxr_produce2f(al_sfxr_Decoder* const decoder, float* frames, size_t const num_frames);
-#endif /* AL_SFXR_FLOAT_STEREO */
+int al_sfxr_seedbank_open(al_sfxr_SeedBank* const bank, void const* const data, size_t const size);
 
-#endif /* !AL_SFXR_H */
+/**
+ * Decodes a record of a seed bank, usually bank->index[i].record, into the
+ * arguments it was written with.
+ *
+ * @param bank the seed bank
+ * @param record the record, less than bank->count
+ * @param seed where the arguments are decoded, with a volume of -1 if the
+ *        record doesn't replace the generated one
+ */
+void al_sfxr_seedbank_seed(al_sfxr_SeedBank const* const bank, uint32_t const record, al_sfxr_Seed* const seed);
 
-#if defined(AL_SFXR_IMPLEMENTATION)
+/**
+ * Gives a seed bank a memoization table with a slot for each of its
+ * bank->count sounds, which must be zeroed and outlive the bank.
+ *
+ * @param bank the seed bank
+ * @param slots the memoization table
+ */
+void al_sfxr_seedbank_memoize(al_sfxr_SeedBank* const bank, al_sfxr_SeedSlot* const slots);
 
-#include <string.h>
-#include <math.h>
+/**
+ * Finds a sound in a seed bank and returns its parameters, generating them if
+ * they aren't memoized. Never waits for other threads: if another thread is
+ * generating the same sound, or there's no memoization table, the parameters
+ * are generated into params.
+ *
+ * @param bank the seed bank
+ * @param id the id of the sound
+ * @param params where the parameters are generated when they can't be
+ *        memoized
+ *
+ * @return the parameters of the sound, in the memoization table or in
+ *         params, or NULL if the bank doesn't have the id
+ */
+al_sfxr_Params const* al_sfxr_seedbank_find(al_sfxr_SeedBank* const bank, uint32_t const id,
+                                            al_sfxr_Params* const params);
 
-static void al_sfxr_newprng(al_sfxr_Prng* const prng, uint64_t const seed) {
-    prng->seed = seed + (seed == 0);
+/**
+ * Generates and memoizes the parameters of the sounds with records from first
+ * to first + count - 1 that aren't memoized yet, usually in a worker thread
+ * at startup so that al_sfxr_seedbank_find doesn't have to. Many threads can
+ * generate different or the same ranges at the same time.
+ *
+ * @param bank the seed bank, which must have a memoization table
+ * @param first the first record
+ * @param count the number of records
+ *
+ * @return the number of sounds generated by this call
+ */
+size_t al_sfxr_seedbank_generate(al_sfxr_SeedBank* const bank, size_t const first, size_t const count);
+#endif /* AL_SFXR_GENERATE */
+#endif /* AL_SFXR_BANK */
+
+#if defined(AL_SFXR_QUANTIZE)
+/**
+ * The parameters of a SFXR quantized to 8 bits per field, in 24 bytes instead
+ * of the 96 bytes of al_sfxr_Params. The fields are the ones of
+ * al_sfxr_Params in the same order, starting with the wave type. Fields that
+ * al_sfxr_generate keeps in [0, 1] are stored as 0 to 255, and fields in
+ * [-1, 1] as 1 to 255, with 128 for zero. Zero, one, and minus one are exact.
+ * p_base_freq and p_freq_limit are stored on a log scale of the pitch they
+ * give, ln(1000 * p * p + 1) / ln(1001), so that each step changes the pitch
+ * by the same number of cents, about 47 with 8 bits.
+ *
+ * @see al_sfxr_pack8
+ */
+typedef struct {
+    uint8_t fields[24];
+}
+al_sfxr_Params8;
+
+/**
+ * The parameters of a SFXR quantized to 16 bits per field, in 48 bytes. The
+ * fields are stored in the same order and in the same way as in
+ * al_sfxr_Params8, as 0 to 65535, or 1 to 65535 with 32768 for zero, in the
+ * byte order of the platform.
+ *
+ * @see al_sfxr_pack16
+ */
+typedef struct {
+    uint16_t fields[24];
+}
+al_sfxr_Params16;
+
+/**
+ * Quantizes SFXRs to 8 bits per field. Fields out of their range are clamped
+ * to it, and NaNs become the lowest value. Unpacking and packing again gives
+ * the same bytes, and so does saving and loading the unpacked parameters.
+ *
+ * @param packed where the quantized SFXRs will be written to
+ * @param params the SFXRs to quantize
+ * @param count the number of SFXRs
+ *
+ * @see al_sfxr_unpack8
+ */
+void al_sfxr_pack8(al_sfxr_Params8* const packed, al_sfxr_Params const* const params, size_t const count);
+
+/**
+ * Restores the parameters of SFXRs quantized with al_sfxr_pack8.
+ *
+ * @param params where the SFXRs will be written to
+ * @param packed the quantized SFXRs
+ * @param count the number of SFXRs
+ *
+ * @see al_sfxr_pack8
+ */
+void al_sfxr_unpack8(al_sfxr_Params* const params, al_sfxr_Params8 const* const packed, size_t const count);
+
+/**
+ * Quantizes SFXRs to 16 bits per field, in the same way as al_sfxr_pack8.
+ *
+ * @param packed where the quantized SFXRs will be written to
+ * @param params the SFXRs to quantize
+ * @param count the number of SFXRs
+ *
+ * @see al_sfxr_unpack16
+ */
+void al_sfxr_pack16(al_sfxr_Params16* const packed, al_sfxr_Params const* const params, size_t const count);
+
+/**
+ * Restores the parameters of SFXRs quantized with al_sfxr_pack16.
+ *
+ * @param params where the SFXRs will be written to
+ * @param packed the quantized SFXRs
+ * @param count the number of SFXRs
+ *
+ * @see al_sfxr_pack16
+ */
+void al_sfxr_unpack16(al_sfxr_Params* const params, al_sfxr_Params16 const* const packed, size_t const count);
+#endif /* AL_SFXR_QUANTIZE */
+
+/**
+ * Starts playing a SFXR. A playing SFXR is called a decoder, and there can be
+ * many voices playing concurrently for the same SFXR. The parameters will be
+ * compiled into a patch owned by the decoder and can be disposed when the
+ * function returns. The seed is used to initialize a PRNG to generate noise
+ * during play, if needed.
+ *
+ * @param decoder the playing decoder created by the function
+ * @param params the SFXR to play
+ * @param seed the seed for the PRNG
+ *
+ * @see al_sfxr_start_quick
+ * @see al_sfxr_restart
+ */
+void al_sfxr_start(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params, uint64_t const seed);
+
+/**
+ * The range of the sample rates that sounds can be rendered at. Rates out of
+ * the range are clamped to it.
+ */
+#define AL_SFXR_MIN_RATE 8000
+#define AL_SFXR_MAX_RATE 192000
+
+/**
+ * Starts playing a SFXR at the given sample rate instead of 44100 Hz. The
+ * sound has the same duration and pitch as at 44100 Hz.
+ *
+ * @param decoder the playing decoder created by the function
+ * @param params the SFXR to play
+ * @param seed the seed for the PRNG
+ * @param sample_rate the sample rate of the frames, in Hz, from
+ *        AL_SFXR_MIN_RATE to AL_SFXR_MAX_RATE
+ *
+ * @see al_sfxr_start
+ * @see al_sfxr_compile_rate
+ */
+void al_sfxr_start_rate(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params, uint64_t const seed,
+                        unsigned const sample_rate);
+
+/**
+ * Starts playing a SFXR at the given sample rate and oversampling factor.
+ *
+ * @param decoder the playing decoder created by the function
+ * @param params the SFXR to play
+ * @param seed the seed for the PRNG
+ * @param sample_rate the sample rate of the frames, in Hz, from
+ *        AL_SFXR_MIN_RATE to AL_SFXR_MAX_RATE
+ * @param oversampling the number of sub-samples per frame, 1, 2, 4, or 8
+ *
+ * @see al_sfxr_start_rate
+ * @see al_sfxr_compile_ex
+ */
+void al_sfxr_start_ex(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params, uint64_t const seed,
+                      unsigned const sample_rate, unsigned const oversampling);
+
+/**
+ * Starts playing a SFXR. The parameters will be compiled into the decoder and
+ * can be disposed when the function returns. It uses the Newlib LCG with a
+ * hardcoded seed.
+ *
+ * @param decoder the playing decoder created by the function
+ * @param params the SFXR to play
+ *
+ * @see al_sfxr_start
+ * @see al_sfxr_restart
+ */
+void al_sfxr_start_quick(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params);
+
+/**
+ * Restarts a SFXR, leaving the decoder in the same state as it was when one
+ * of the start functions was called to create the decoder.
+ *
+ * @param decoder the playing decoder created by the function
+ * @param params the SFXR to play
+ * @param seed the seed for the PRNG
+ *
+ * @see al_sfxr_start
+ * @see al_sfxr_start_quick
+ */
+void al_sfxr_restart(al_sfxr_Decoder* const decoder);
+
+/**
+ * Sets the rendering mode of a decoder. The start functions reset the mode to
+ * 0, so this must be called after them, and it can be called at any time
+ * while the decoder is playing.
+ *
+ * @param decoder the decoder
+ * @param mode a combination of al_sfxr_Mode values, or 0 for exact output
+ *
+ * @see al_sfxr_Mode
+ */
+void al_sfxr_set_mode(al_sfxr_Decoder* const decoder, unsigned const mode);
+
+#if defined(AL_SFXR_PROFILE)
+/**
+ * Gets the counters of a decoder since it was started.
+ *
+ * @param decoder the decoder
+ * @param profile the counters returned by the function
+ *
+ * @see al_sfxr_Profile
+ */
+void al_sfxr_get_profile(al_sfxr_Decoder const* const decoder, al_sfxr_Profile* const profile);
+#endif /* AL_SFXR_PROFILE */
+
+/**
+ * Produces num_frames of 32-bit float mono audio into the output buffer, at
+ * the sample rate of the decoder. Instead of running all the per-frame checks
+ * for every frame, it renders the frames between repeat, arpeggio, and
+ * envelope events in a tight loop. The output is the same as the one produced
+ * by the other produce functions, which are implemented on top of it.
+ *
+ * @param decoder the decoder from which to generate the audio frames
+ * @param frames the output buffer
+ * @param num_frames the number of frames to write
+ *
+ * @result the number of frames written, less than num_frames if the sound
+ *         ended
+ *
+ * @see al_sfxr_produce1f
+ */
+size_t al_sfxr_produce_block(al_sfxr_Decoder* const decoder, float* const frames, size_t const num_frames);
+
+/**
+ * Compiles SFXR parameters into a patch, computing all the values that the
+ * synthesis derives from them. The parameters can be disposed when the
+ * function returns.
+ *
+ * @param patch the patch created by the function
+ * @param params the SFXR to compile
+ *
+ * @see al_sfxr_voice_start
+ */
+void al_sfxr_compile(al_sfxr_Patch* const patch, al_sfxr_Params const* const params);
+
+/**
+ * Compiles SFXR parameters into a patch that renders at the given sample rate
+ * instead of 44100 Hz. Durations, frequencies, and sweeps are rescaled so the
+ * sound is the same as at 44100 Hz, and the patch is the same one compiled by
+ * al_sfxr_compile when the rate is 44100. The longest phaser offset isn't
+ * rescaled.
+ *
+ * @param patch the patch created by the function
+ * @param params the SFXR to compile
+ * @param sample_rate the sample rate of the frames, in Hz, from
+ *        AL_SFXR_MIN_RATE to AL_SFXR_MAX_RATE
+ *
+ * @see al_sfxr_compile
+ */
+void al_sfxr_compile_rate(al_sfxr_Patch* const patch, al_sfxr_Params const* const params,
+                          unsigned const sample_rate);
+
+/**
+ * Compiles SFXR parameters into a patch that renders at the given sample rate
+ * and oversampling factor. The synthesis runs at the sample rate times the
+ * oversampling factor, and the sub-samples are filtered down to frames. The
+ * other compile functions use 8, which is the most expensive setting and
+ * produces the exact output of the original implementation, filtering with
+ * the average of the sub-samples of each frame. 1, 2, and 4 cost about that
+ * fraction of the time and filter with a triangle two frames wide, which
+ * rejects more of the aliasing that the lower rates let through. Square and
+ * sawtooth waves can also use AL_SFXR_MODE_BANDLIMITED to reduce aliasing
+ * further at the lower factors.
+ *
+ * @param patch the patch created by the function
+ * @param params the SFXR to compile
+ * @param sample_rate the sample rate of the frames, in Hz, from
+ *        AL_SFXR_MIN_RATE to AL_SFXR_MAX_RATE
+ * @param oversampling the number of sub-samples per frame, 1, 2, 4, or 8
+ *
+ * @see al_sfxr_compile_rate
+ * @see al_sfxr_Mode
+ */
+void al_sfxr_compile_ex(al_sfxr_Patch* const patch, al_sfxr_Params const* const params,
+                        unsigned const sample_rate, unsigned const oversampling);
+
+/**
+ * Computes the number of frames that a SFXR produces before ending, without
+ * rendering it. The count takes the envelope, the repeats, and the frequency
+ * limit into account, and is the same that the produce functions write.
+ *
+ * @param params the SFXR
+ *
+ * @return the number of frames of the sound
+ */
+size_t al_sfxr_length(al_sfxr_Params const* const params);
+
+/**
+ * Computes the number of frames that a SFXR produces at the given sample
+ * rate before ending, without rendering it.
+ *
+ * @param params the SFXR
+ * @param sample_rate the sample rate of the frames, in Hz, from
+ *        AL_SFXR_MIN_RATE to AL_SFXR_MAX_RATE
+ *
+ * @return the number of frames of the sound
+ *
+ * @see al_sfxr_length
+ */
+size_t al_sfxr_length_rate(al_sfxr_Params const* const params, unsigned const sample_rate);
+
+/**
+ * Estimates the peak absolute value of the frames that a SFXR produces,
+ * without rendering it. The estimate is conservative, the sound never goes
+ * above it, but it only takes the wave amplitude, the envelope punch, the
+ * filters, the phaser, and the volume into account. Sounds using the
+ * resonant low-pass filter always estimate 1.0.
+ *
+ * @param params the SFXR
+ *
+ * @return the peak estimate, from 0.0 to 1.0
+ */
+float al_sfxr_peak(al_sfxr_Params const* const params);
+
+/**
+ * Initializes a pool with the given phaser delay lines, which must outlive
+ * the pool.
+ *
+ * @param pool the pool to initialize
+ * @param lines the lines in the pool
+ * @param count the number of lines
+ */
+void al_sfxr_pool_init(al_sfxr_PhaserPool* const pool, al_sfxr_PhaserLine* const lines, size_t const count);
+
+/**
+ * Starts playing a patch. The patch is referenced by the voice and must not
+ * be changed or disposed while the voice uses it, but any number of voices
+ * can share it. If the patch uses the phaser, a delay line is taken from the
+ * pool, otherwise the pool isn't used and can be NULL. The voice must be
+ * stopped with al_sfxr_voice_stop before it's started again.
+ *
+ * @param voice the playing voice created by the function
+ * @param patch the patch to play
+ * @param seed the seed for the PRNG
+ * @param pool the pool with the phaser delay lines
+ *
+ * @return 0 on success, or -1 if the patch uses the phaser and there are no
+ *         free delay lines in the pool
+ *
+ * @see al_sfxr_start
+ * @see al_sfxr_voice_stop
+ */
+int al_sfxr_voice_start(al_sfxr_Voice* const voice, al_sfxr_Patch const* const patch, uint64_t const seed,
+                        al_sfxr_PhaserPool* const pool);
+
+/**
+ * Stops a voice, and returns its phaser delay line to the pool if it has one.
+ * It must be called for voices that ended by themselves too.
+ *
+ * @param voice the voice
+ * @param pool the pool the voice took its delay line from
+ */
+void al_sfxr_voice_stop(al_sfxr_Voice* const voice, al_sfxr_PhaserPool* const pool);
+
+/**
+ * Restarts a voice, leaving it in the same state as it was when
+ * al_sfxr_voice_start was called to create it.
+ *
+ * @param voice the voice
+ *
+ * @see al_sfxr_restart
+ */
+void al_sfxr_voice_restart(al_sfxr_Voice* const voice);
+
+/**
+ * Sets the rendering mode of a voice.
+ *
+ * @param voice the voice
+ * @param mode a combination of al_sfxr_Mode values, or 0 for exact output
+ *
+ * @see al_sfxr_set_mode
+ */
+void al_sfxr_voice_set_mode(al_sfxr_Voice* const voice, unsigned const mode);
+
+#if defined(AL_SFXR_PROFILE)
+/**
+ * Gets the counters of a voice since it was started.
+ *
+ * @param voice the voice
+ * @param profile the counters returned by the function
+ *
+ * @see al_sfxr_get_profile
+ */
+void al_sfxr_voice_get_profile(al_sfxr_Voice const* const voice, al_sfxr_Profile* const profile);
+#endif /* AL_SFXR_PROFILE */
+
+/**
+ * Produces num_frames of 32-bit float mono audio for a voice into the output
+ * buffer, at the sample rate of its patch.
+ *
+ * @param voice the voice from which to generate the audio frames
+ * @param frames the output buffer
+ * @param num_frames the number of frames to write
+ *
+ * @result the number of frames written, less than num_frames if the sound
+ *         ended
+ *
+ * @see al_sfxr_produce_block
+ */
+size_t al_sfxr_voice_produce(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames);
+
+/**
+ * Renders num_frames of 32-bit float mono audio for a voice, multiplies them
+ * by gain, and adds them to the frames already in the output buffer, so many
+ * voices can be mixed into a bus without a scratch buffer for each one. The
+ * frames after the end of the sound are left untouched.
+ *
+ * @param voice the voice from which to generate the audio frames
+ * @param frames the buffer to mix into
+ * @param num_frames the number of frames to mix
+ * @param gain the gain applied to the voice
+ * @param clamp clamps the voice to [-1, 1] before applying the gain like
+ *        al_sfxr_voice_produce when non-zero, otherwise leaves the headroom
+ *        to the final limiting of the bus
+ *
+ * @result the number of frames mixed, less than num_frames if the sound ended
+ *
+ * @see al_sfxr_mix1f
+ */
+size_t al_sfxr_voice_mix1f(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames, float const gain,
+                           int const clamp);
+
+/**
+ * Same as al_sfxr_voice_mix1f, but adds the voice to both channels of a
+ * 32-bit float stereo buffer, panned with constant power.
+ *
+ * @param voice the voice from which to generate the audio frames
+ * @param frames the buffer to mix into, with interleaved left and right
+ *        samples
+ * @param num_frames the number of frames to mix
+ * @param gain the gain applied to the voice
+ * @param pan from -1 for left to 1 for right, 0 is the center where each
+ *        channel gets the voice at -3 dB
+ * @param clamp clamps the voice to [-1, 1] before applying the gain and
+ *        panning when non-zero
+ *
+ * @result the number of frames mixed, less than num_frames if the sound ended
+ *
+ * @see al_sfxr_mix2f
+ */
+size_t al_sfxr_voice_mix2f(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames, float const gain,
+                           float const pan, int const clamp);
+
+#if defined(AL_SFXR_INT16_MONO)
+/**
+ * Produces num_frames of mono audio into the output buffer. The buffer must
+ * have num_frames * 2 bytes available.
+ *
+ * @param decoder the decoder from which to generate the audio frames
+ * @param frames the output buffer
+ * @param num_frames the number of frames to write
+ *
+ * @result the number of frames written
+ *
+ * @see al_sfxr_produce2i
+ * @see al_sfxr_produce1f
+ * @see al_sfxr_produce2f
+ */
+size_t al_sfxr_produce1i(al_sfxr_Decoder* const decoder, int16_t* frames, size_t const num_frames);
+
+/**
+ * Converts 32-bit float mono frames to signed 16-bit mono frames, using SSE2
+ * when available. Frames outside [-1, 1] saturate, and NaNs become 0. The
+ * result is the same as the one of al_sfxr_produce1i, and can be used to
+ * convert the output of a mixer once instead of the output of each voice.
+ *
+ * @param dest the output buffer, with num_frames * 2 bytes available
+ * @param source the frames to convert
+ * @param num_frames the number of frames to convert
+ */
+void al_sfxr_convert1i(int16_t* const dest, float const* const source, size_t const num_frames);
+#endif /* AL_SFXR_INT16_MONO */
+
+#if defined(AL_SFXR_INT16_STEREO)
+/**
+ * Produces num_frames of stereo audio into the output buffer. The buffer must
+ * have num_frames * 4 bytes available.
+ *
+ * @param decoder the decoder from which to generate the audio frames
+ * @param frames the output buffer
+ * @param num_frames the number of frames to write
+ *
+ * @result the number of frames written
+ *
+ * @see al_sfxr_produce1i
+ * @see al_sfxr_produce1f
+ * @see al_sfxr_produce2f
+ */
+size_t al_sfxr_produce2i(al_sfxr_Decoder* const decoder, int16_t* frames, size_t const num_frames);
+
+/**
+ * Converts 32-bit float mono frames to signed 16-bit stereo frames with the
+ * same sample in both channels, using SSE2 when available. Frames outside
+ * [-1, 1] saturate, and NaNs become 0.
+ *
+ * @param dest the output buffer, with num_frames * 4 bytes available
+ * @param source the frames to convert
+ * @param num_frames the number of frames to convert
+ *
+ * @see al_sfxr_convert1i
+ */
+void al_sfxr_convert2i(int16_t* const dest, float const* const source, size_t const num_frames);
+#endif /* AL_SFXR_INT16_STEREO */
+
+#if defined(AL_SFXR_FLOAT_MONO)
+/**
+ * Produces num_frames of mono audio into the output buffer. The buffer must
+ * have num_frames * 4 bytes available.
+ *
+ * @param decoder the decoder from which to generate the audio frames
+ * @param frames the output buffer
+ * @param num_frames the number of frames to write
+ *
+ * @result the number of frames written
+ *
+ * @see al_sfxr_produce1i
+ * @see al_sfxr_produce2i
+ * @see al_sfxr_produce2f
+ */
+size_t al_sfxr_produce1f(al_sfxr_Decoder* const decoder, float* frames, size_t const num_frames);
+
+/**
+ * Adds num_frames of mono audio multiplied by gain to the frames in the
+ * buffer, see al_sfxr_voice_mix1f.
+ *
+ * @param decoder the decoder from which to generate the audio frames
+ * @param frames the buffer to mix into
+ * @param num_frames the number of frames to mix
+ * @param gain the gain applied to the sound
+ * @param clamp clamps the sound to [-1, 1] before applying the gain when
+ *        non-zero
+ *
+ * @result the number of frames mixed
+ *
+ * @see al_sfxr_mix2f
+ */
+size_t al_sfxr_mix1f(al_sfxr_Decoder* const decoder, float* const frames, size_t const num_frames, float const gain,
+                     int const clamp);
+#endif /* AL_SFXR_FLOAT_MONO */
+
+#if defined(AL_SFXR_FLOAT_STEREO)
+/**
+ * Produces num_frames of stereo audio into the output buffer. The buffer must
+ * have num_frames * 8 bytes available.
+ *
+ * @param decoder the decoder from which to generate the audio frames
+ * @param frames the output buffer
+ * @param num_frames the number of frames to write
+ *
+ * @result the number of frames written
+ *
+ * @see al_sfxr_produce1i
+ * @see al_sfxr_produce2i
+ * @see al_sfxr_produce1f
+ */
+size_t al_sfxr_produce2f(al_sfxr_Decoder* const decoder, float* frames, size_t const num_frames);
+
+/**
+ * Converts 32-bit float mono frames to 32-bit float stereo frames with the
+ * same sample in both channels, using SSE2 when available.
+ *
+ * @param dest the output buffer, with num_frames * 8 bytes available
+ * @param source the frames to convert, which can't overlap dest
+ * @param num_frames the number of frames to convert
+ *
+ * @see al_sfxr_convert1i
+ */
+void al_sfxr_convert2f(float* const dest, float const* const source, size_t const num_frames);
+
+/**
+ * Adds num_frames of stereo audio multiplied by gain and panned to the frames
+ * in the buffer, see al_sfxr_voice_mix2f.
+ *
+ * @param decoder the decoder from which to generate the audio frames
+ * @param frames the buffer to mix into, with interleaved left and right
+ *        samples
+ * @param num_frames the number of frames to mix
+ * @param gain the gain applied to the sound
+ * @param pan from -1 for left to 1 for right
+ * @param clamp clamps the sound to [-1, 1] before applying the gain and
+ *        panning when non-zero
+ *
+ * @result the number of frames mixed
+ *
+ * @see al_sfxr_mix1f
+ */
+size_t al_sfxr_mix2f(al_sfxr_Decoder* const decoder, float* const frames, size_t const num_frames, float const gain,
+                     float const pan, int const clamp);
+#endif /* AL_SFXR_FLOAT_STEREO */
+
+#if defined(AL_SFXR_BATCH)
+/**
+ * The number of voices in a batch, 8 when compiled with AVX2 and 4 otherwise.
+ */
+#if defined(__AVX2__) && !defined(AL_SFXR_NO_SIMD)
+#define AL_SFXR_BATCH_LANES 8
+#else
+#define AL_SFXR_BATCH_LANES 4
+#endif
+
+/**
+ * A batch of decoders that are rendered together. The frame-rate state of each
+ * lane is kept in a regular voice, while the state that changes for every
+ * supersample is kept in structure-of-arrays form so that all the voices, or
+ * lanes, are advanced at once with SSE2 or AVX2 instructions when available.
+ */
+typedef struct {
+    al_sfxr_Voice voices[AL_SFXR_BATCH_LANES];
+    al_sfxr_Patch patches[AL_SFXR_BATCH_LANES];
+    unsigned playing;
+    int ipp;
+
+    int wave_type[AL_SFXR_BATCH_LANES];
+    int lpf_on[AL_SFXR_BATCH_LANES];
+    int phase[AL_SFXR_BATCH_LANES];
+    int period[AL_SFXR_BATCH_LANES];
+    int iphase[AL_SFXR_BATCH_LANES];
+    float square_duty[AL_SFXR_BATCH_LANES];
+    float env_vol[AL_SFXR_BATCH_LANES];
+    float volume[AL_SFXR_BATCH_LANES];
+    float fltp[AL_SFXR_BATCH_LANES];
+    float fltdp[AL_SFXR_BATCH_LANES];
+    float fltw[AL_SFXR_BATCH_LANES];
+    float fltw_d[AL_SFXR_BATCH_LANES];
+    float fltdmp[AL_SFXR_BATCH_LANES];
+    float fltphp[AL_SFXR_BATCH_LANES];
+    float flthp[AL_SFXR_BATCH_LANES];
+    float noise_buffer[32][AL_SFXR_BATCH_LANES];
+    float phaser_buffer[1024][AL_SFXR_BATCH_LANES];
+}
+al_sfxr_DecoderBatch;
+
+/**
+ * Initializes a batch with all its lanes idle.
+ *
+ * @param batch the batch to initialize
+ */
+void al_sfxr_batch_init(al_sfxr_DecoderBatch* const batch);
+
+/**
+ * Starts playing a SFXR in one of the lanes of the batch, replacing the sound
+ * that was playing there if any. The parameters will be copied and can be
+ * disposed when the function returns. Batches always render at 44100 Hz with
+ * 8x oversampling; use voices or an al_sfxr_Mixer with patches compiled by
+ * al_sfxr_compile_rate for other sample rates.
+ *
+ * @param batch the batch
+ * @param lane the lane, from 0 to AL_SFXR_BATCH_LANES - 1
+ * @param params the SFXR to play
+ * @param seed the seed for the PRNG
+ *
+ * @see al_sfxr_start
+ */
+void al_sfxr_batch_start(al_sfxr_DecoderBatch* const batch, unsigned const lane, al_sfxr_Params const* const params, uint64_t const seed);
+
+/**
+ * Stops the sound playing in one of the lanes of the batch.
+ *
+ * @param batch the batch
+ * @param lane the lane, from 0 to AL_SFXR_BATCH_LANES - 1
+ */
+void al_sfxr_batch_stop(al_sfxr_DecoderBatch* const batch, unsigned const lane);
+
+/**
+ * Produces num_frames of 44100 Hz, 32-bit float mono audio into the output
+ * buffer, with the sum of all the lanes of the batch. The result is the same
+ * as adding, in lane order, the output of al_sfxr_produce_block for a decoder
+ * playing the same sound as each lane. Lanes that end during the call
+ * contribute silence from then on, and all num_frames frames are always
+ * written.
+ *
+ * @param batch the batch from which to generate the audio frames
+ * @param frames the output buffer
+ * @param num_frames the number of frames to write
+ *
+ * @return a bit mask with the lanes that are still playing
+ */
+unsigned al_sfxr_batch_produce(al_sfxr_DecoderBatch* const batch, float* const frames, size_t const num_frames);
+#endif /* AL_SFXR_BATCH */
+
+#if defined(AL_SFXR_CACHE)
+/**
+ * The number of hash buckets in a cache.
+ */
+#define AL_SFXR_CACHE_BUCKETS 256
+
+/**
+ * A sound rendered by a cache. Only frames and num_frames are meant to be
+ * read, the other fields are managed by the cache.
+ */
+typedef struct al_sfxr_CacheEntry {
+    float const* frames;
+    size_t num_frames;
+
+    al_sfxr_Params params;
+    uint64_t seed;
+    uint64_t hash;
+    size_t bytes;
+    unsigned refs;
+    struct al_sfxr_CacheEntry* next;
+    struct al_sfxr_CacheEntry* older;
+    struct al_sfxr_CacheEntry* newer;
+}
+al_sfxr_CacheEntry;
+
+/**
+ * A cache of rendered sounds keyed by their parameters and seed. Sounds are
+ * rendered to 44100 Hz, 32-bit float mono frames the first time they're
+ * requested, and the least recently used ones are freed when the memory used
+ * goes over the budget. The cache isn't thread-safe.
+ */
+typedef struct {
+    size_t budget;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    al_sfxr_CacheEntry* newest;
+    al_sfxr_CacheEntry* oldest;
+    al_sfxr_CacheEntry* buckets[AL_SFXR_CACHE_BUCKETS];
+}
+al_sfxr_Cache;
+
+/**
+ * Initializes an empty cache.
+ *
+ * @param cache the cache to initialize
+ * @param budget the maximum number of bytes used by the rendered sounds
+ */
+void al_sfxr_cache_init(al_sfxr_Cache* const cache, size_t const budget);
+
+/**
+ * Frees all the sounds in the cache, including the ones that were not
+ * released.
+ *
+ * @param cache the cache
+ */
+void al_sfxr_cache_destroy(al_sfxr_Cache* const cache);
+
+/**
+ * Returns the rendered sound for the parameters and seed, rendering it if it's
+ * not in the cache. The sound won't be evicted until it's released, so the
+ * cache can go over its budget while too many sounds are acquired.
+ *
+ * @param cache the cache
+ * @param params the SFXR to render
+ * @param seed the seed for the PRNG, as in al_sfxr_start
+ *
+ * @return the rendered sound, or NULL if there's not enough memory
+ *
+ * @see al_sfxr_cache_release
+ */
+al_sfxr_CacheEntry const* al_sfxr_cache_acquire(al_sfxr_Cache* const cache, al_sfxr_Params const* const params, uint64_t const seed);
+
+/**
+ * Releases a sound returned by al_sfxr_cache_acquire, allowing it to be
+ * evicted.
+ *
+ * @param cache the cache
+ * @param entry the sound
+ */
+void al_sfxr_cache_release(al_sfxr_Cache* const cache, al_sfxr_CacheEntry const* const entry);
+#endif /* AL_SFXR_CACHE */
+
+#if defined(AL_SFXR_MIXER)
+/**
+ * A voice in a mixer. The patch is copied when the voice starts, so patches
+ * can be disposed after being played. A voice with an id of 0 is free.
+ */
+typedef struct {
+    al_sfxr_Voice voice;
+    al_sfxr_Patch patch;
+    float gain;
+    int priority;
+    unsigned id;
+    uint32_t started;
+}
+al_sfxr_MixerVoice;
+
+/**
+ * A mixer that plays many voices at once from a fixed pool of voices and
+ * phaser delay lines provided by the caller. When a sound is played and no
+ * voice is available, the voice with the lowest priority is stolen, and the
+ * oldest one among voices with the same priority. When a sound that uses the
+ * phaser is played and no delay line is free, the voice holding a line that
+ * would be stolen first is stopped, and is the one stolen when there isn't a
+ * free voice. The mixer never allocates memory and isn't thread-safe, use an
+ * al_sfxr_Queue to control it from other threads.
+ */
+typedef struct {
+    al_sfxr_MixerVoice* voices;
+    unsigned num_voices;
+    unsigned polyphony;
+    unsigned volatile next_id;
+    uint32_t clock;
+    unsigned mode;
+    al_sfxr_PhaserPool pool;
+}
+al_sfxr_Mixer;
+
+/**
+ * Initializes a mixer with all its voices free. The polyphony starts at the
+ * number of voices.
+ *
+ * @param mixer the mixer to initialize
+ * @param voices the voices of the mixer
+ * @param num_voices the number of voices
+ * @param lines the phaser delay lines for the voices that use the phaser
+ * @param num_lines the number of delay lines
+ */
+void al_sfxr_mixer_init(al_sfxr_Mixer* const mixer, al_sfxr_MixerVoice* const voices, unsigned const num_voices,
+                        al_sfxr_PhaserLine* const lines, size_t const num_lines);
+
+/**
+ * Sets the maximum number of voices that can play at the same time. Voices
+ * over the new limit are stopped, starting with the ones that would be
+ * stolen first.
+ *
+ * @param mixer the mixer
+ * @param polyphony the maximum number of voices, up to the number of voices
+ *        of the mixer
+ */
+void al_sfxr_mixer_set_polyphony(al_sfxr_Mixer* const mixer, unsigned const polyphony);
+
+/**
+ * Sets the rendering mode of the voices that are playing and of the ones that
+ * are played from now on. Mixers start with mode 0.
+ *
+ * @param mixer the mixer
+ * @param mode a combination of al_sfxr_Mode values, or 0 for exact output
+ *
+ * @see al_sfxr_Mode
+ */
+void al_sfxr_mixer_set_mode(al_sfxr_Mixer* const mixer, unsigned const mode);
+
+/**
+ * Starts playing a patch, stealing a voice if needed.
+ *
+ * @param mixer the mixer
+ * @param patch the patch to play
+ * @param seed the seed for the PRNG
+ * @param gain the gain applied to the frames of the voice
+ * @param priority the voice priority, voices with a higher priority can steal
+ *        voices with a lower or equal priority
+ *
+ * @return the id of the voice, or 0 if all the voices have a higher priority
+ *
+ * @see al_sfxr_mixer_stop
+ */
+unsigned al_sfxr_mixer_play(al_sfxr_Mixer* const mixer, al_sfxr_Patch const* const patch, uint64_t const seed,
+                            float const gain, int const priority);
+
+/**
+ * Stops a voice. Nothing happens if the voice has already ended.
+ *
+ * @param mixer the mixer
+ * @param id the id returned by al_sfxr_mixer_play
+ */
+void al_sfxr_mixer_stop(al_sfxr_Mixer* const mixer, unsigned const id);
+
+/**
+ * Stops all the voices.
+ *
+ * @param mixer the mixer
+ */
+void al_sfxr_mixer_stop_all(al_sfxr_Mixer* const mixer);
+
+/**
+ * Changes the gain of a voice. Nothing happens if the voice has already
+ * ended.
+ *
+ * @param mixer the mixer
+ * @param id the id returned by al_sfxr_mixer_play
+ * @param gain the new gain
+ */
+void al_sfxr_mixer_set_gain(al_sfxr_Mixer* const mixer, unsigned const id, float const gain);
+
+/**
+ * Produces num_frames of 32-bit float mono audio with the sum of all the
+ * playing voices, each one multiplied by its gain. The sum isn't clamped.
+ * Voices that end are freed. All the patches played by a mixer should be
+ * compiled for the same sample rate.
+ *
+ * @param mixer the mixer
+ * @param frames the output buffer
+ * @param num_frames the number of frames to write
+ *
+ * @return the number of voices still playing
+ */
+unsigned al_sfxr_mixer_produce(al_sfxr_Mixer* const mixer, float* const frames, size_t const num_frames);
+
+/**
+ * The commands that can be sent to a mixer through a queue.
+ */
+typedef enum {
+    AL_SFXR_COMMAND_PLAY,
+    AL_SFXR_COMMAND_STOP,
+    AL_SFXR_COMMAND_STOP_ALL,
+    AL_SFXR_COMMAND_SET_GAIN
+}
+al_sfxr_CommandType;
+
+/**
+ * A command for a mixer. Play commands carry a copy of the patch, so patches
+ * can be disposed right after being queued.
+ */
+typedef struct {
+    al_sfxr_CommandType type;
+    unsigned id;
+    uint64_t seed;
+    float gain;
+    int priority;
+    al_sfxr_Patch patch;
+}
+al_sfxr_Command;
+
+/**
+ * A slot of a queue, holding one command.
+ */
+typedef struct {
+    unsigned volatile sequence;
+    al_sfxr_Command command;
+}
+al_sfxr_QueueSlot;
+
+/**
+ * A bounded queue of commands that other threads use to control a mixer that
+ * is rendered in the audio thread. The audio thread is the only consumer and
+ * drains the queue at the start of each block. With a single producer,
+ * pushing a command is wait-free; with multiple producers, it's lock-free.
+ * The queue never allocates memory and never blocks, and the commands are
+ * executed in the order they were pushed.
+ */
+typedef struct {
+    al_sfxr_Mixer* mixer;
+    al_sfxr_QueueSlot* slots;
+    unsigned mask;
+    int multi_producer;
+    unsigned volatile tail;
+    unsigned head;
+}
+al_sfxr_Queue;
+
+/**
+ * Initializes a queue of commands for a mixer.
+ *
+ * @param queue the queue to initialize
+ * @param mixer the mixer that executes the commands
+ * @param slots the slots of the queue
+ * @param num_slots the number of slots, must be a power of two
+ * @param multi_producer 0 if only one thread pushes commands to the queue,
+ *        non-zero otherwise
+ */
+void al_sfxr_queue_init(al_sfxr_Queue* const queue, al_sfxr_Mixer* const mixer, al_sfxr_QueueSlot* const slots,
+                        unsigned const num_slots, int const multi_producer);
+
+/**
+ * Queues a patch to be played. The id is assigned immediately, so the voice
+ * can be stopped or have its gain changed before the command is executed.
+ *
+ * @param queue the queue
+ * @param patch the patch to play
+ * @param seed the seed for the PRNG
+ * @param gain the gain applied to the frames of the voice
+ * @param priority the voice priority
+ *
+ * @return the id of the voice, or 0 if the queue is full
+ *
+ * @see al_sfxr_mixer_play
+ */
+unsigned al_sfxr_queue_play(al_sfxr_Queue* const queue, al_sfxr_Patch const* const patch, uint64_t const seed,
+                            float const gain, int const priority);
+
+/**
+ * Queues the stop of a voice.
+ *
+ * @param queue the queue
+ * @param id the id returned by al_sfxr_queue_play
+ *
+ * @return 0 on success, -1 if the queue is full
+ *
+ * @see al_sfxr_mixer_stop
+ */
+int al_sfxr_queue_stop(al_sfxr_Queue* const queue, unsigned const id);
+
+/**
+ * Queues the stop of all the voices.
+ *
+ * @param queue the queue
+ *
+ * @return 0 on success, -1 if the queue is full
+ *
+ * @see al_sfxr_mixer_stop_all
+ */
+int al_sfxr_queue_stop_all(al_sfxr_Queue* const queue);
+
+/**
+ * Queues a change in the gain of a voice.
+ *
+ * @param queue the queue
+ * @param id the id returned by al_sfxr_queue_play
+ * @param gain the new gain
+ *
+ * @return 0 on success, -1 if the queue is full
+ *
+ * @see al_sfxr_mixer_set_gain
+ */
+int al_sfxr_queue_set_gain(al_sfxr_Queue* const queue, unsigned const id, float const gain);
+
+/**
+ * Executes all the queued commands on the mixer. Must be called only from the
+ * thread that renders the mixer, usually at the start of the audio callback.
+ *
+ * @param queue the queue
+ *
+ * @return the number of commands executed
+ */
+unsigned al_sfxr_queue_drain(al_sfxr_Queue* const queue);
+#endif /* AL_SFXR_MIXER */
+
+#endif /* !AL_SFXR_H */
+
+#if defined(AL_SFXR_IMPLEMENTATION)
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(_MSC_VER)
+#define AL_SFXR_INLINE __forceinline
+#elif defined(__GNUC__)
+#define AL_SFXR_INLINE inline __attribute__((always_inline))
+#else
+#define AL_SFXR_INLINE inline
+#endif
+
+#if defined(AL_SFXR_PROFILE)
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+
+static AL_SFXR_INLINE uint64_t al_sfxr_cycles(void) {
+    return __rdtsc();
+}
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+
+static AL_SFXR_INLINE uint64_t al_sfxr_cycles(void) {
+    return __rdtsc();
+}
+#elif defined(__GNUC__) && defined(__aarch64__)
+static AL_SFXR_INLINE uint64_t al_sfxr_cycles(void) {
+    uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+}
+#else
+static AL_SFXR_INLINE uint64_t al_sfxr_cycles(void) {
+    return 0;
+}
+#endif
+
+#define AL_SFXR_COUNT(voice, counter) ((voice)->profile.counter++)
+
+/* Adds the time since the previous stage to a stage of a timed frame, uses
+   the variables declared in al_sfxr_render */
+#define AL_SFXR_STAGE(stage) \
+    do { \
+        if (sampled) { \
+            uint64_t const stamp = al_sfxr_cycles(); \
+            cycles[stage] += stamp - last; \
+            last = stamp; \
+        } \
+    } while (0)
+#else
+#define AL_SFXR_COUNT(voice, counter) do {} while (0)
+#define AL_SFXR_STAGE(stage) do {} while (0)
+#endif /* AL_SFXR_PROFILE */
+
+static void al_sfxr_newprng(al_sfxr_Prng* const prng, uint64_t const seed) {
+    prng->seed = seed + (seed == 0);
+}
+
+static uint32_t al_sfxr_randu(al_sfxr_Prng* const prng, uint32_t const max_m1) {
+    if (max_m1 == UINT32_MAX) {
+        prng->seed = UINT64_C(6364136223846793005) * prng->seed + 1;
+        return (uint32_t)(prng->seed >> 32);
+    }
+
+    uint32_t const max = max_m1 + 1;
+    uint64_t const num_fits = ((uint64_t)UINT32_MAX + 1) / max;
+    uint64_t const max_rn = num_fits * max;
+
+    while (1) {
+        prng->seed = UINT64_C(6364136223846793005) * prng->seed + 1;
+        uint32_t const rn = (uint32_t)(prng->seed >> 32);
+
+        if (rn < max_rn) {
+            return rn % max;
+        }
+    }
+}
+
+static float al_sfxr_randf(al_sfxr_Prng* const prng, float const max) {
+    return (float)(al_sfxr_randu(prng, UINT32_MAX)) * max / (float)UINT32_MAX;
+}
+
+#if defined(AL_SFXR_LOAD) || defined(AL_SFXR_GENERATE)
+static void al_sfxr_zero(al_sfxr_Params* const params) {
+    params->wave_type = AL_SFXR_SQUARE;
+
+    params->p_base_freq = 0.3f;
+    params->p_freq_limit = 0.0f;
+    params->p_freq_ramp = 0.0f;
+    params->p_freq_dramp = 0.0f;
+    params->p_duty = 0.0f;
+    params->p_duty_ramp = 0.0f;
+
+    params->p_vib_strength = 0.0f;
+    params->p_vib_speed = 0.0f;
+
+    params->p_env_attack = 0.0f;
+    params->p_env_sustain = 0.3f;
+    params->p_env_decay = 0.4f;
+    params->p_env_punch = 0.0f;
+
+    params->p_lpf_resonance = 0.0f;
+    params->p_lpf_freq = 1.0f;
+    params->p_lpf_ramp = 0.0f;
+    params->p_hpf_freq = 0.0f;
+    params->p_hpf_ramp = 0.0f;
+
+    params->p_pha_offset = 0.0f;
+    params->p_pha_ramp = 0.0f;
+
+    params->p_repeat_speed = 0.0f;
+
+    params->p_arp_speed = 0.0f;
+    params->p_arp_mod = 0.0f;
+
+    params->sound_vol = 0.5f;
+}
+#endif /* defined(AL_SFXR_LOAD) || defined(AL_SFXR_GENERATE) */
+
+#if defined(AL_SFXR_LOAD)
+/* Size of a SFXR file of the given version, 0 for unknown versions */
+static size_t al_sfxr_filesize(uint32_t const version) {
+    switch (version) {
+        case 100:
+            return 89;
+
+        case 101:
+            return 101;
+
+        case 102:
+            return 105;
+
+        default:
+            return 0;
+    }
+}
+
+/* Little-endian reads from a buffer that advance it */
+static uint32_t al_sfxr_get32(uint8_t const** const data) {
+    uint8_t const* const p = *data;
+    *data = p + 4;
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static float al_sfxr_getf(uint8_t const** const data) {
+    uint32_t const dword = al_sfxr_get32(data);
+    float fp;
+    memcpy((void*)&fp, (void const*)&dword, sizeof(fp));
+    return fp;
+}
+
+/* Decodes a whole SFXR file, whose size must have been checked with
+   al_sfxr_filesize */
+static void al_sfxr_decode(al_sfxr_Params* const params, uint8_t const* data) {
+    uint32_t const version = al_sfxr_get32(&data);
+
+    al_sfxr_zero(params);
+    params->wave_type = (al_sfxr_Wave)(int)al_sfxr_get32(&data);
+
+    if (version == 102) {
+        params->sound_vol = al_sfxr_getf(&data);
+    }
+
+    params->p_base_freq = al_sfxr_getf(&data);
+    params->p_freq_limit = al_sfxr_getf(&data);
+    params->p_freq_ramp = al_sfxr_getf(&data);
+
+    if (version >= 101) {
+        params->p_freq_dramp = al_sfxr_getf(&data);
+    }
+
+    params->p_duty = al_sfxr_getf(&data);
+    params->p_duty_ramp = al_sfxr_getf(&data);
+
+    params->p_vib_strength = al_sfxr_getf(&data);
+    params->p_vib_speed = al_sfxr_getf(&data);
+    data += 4; /* vib_delay, unused */
+
+    params->p_env_attack = al_sfxr_getf(&data);
+    params->p_env_sustain = al_sfxr_getf(&data);
+    params->p_env_decay = al_sfxr_getf(&data);
+    params->p_env_punch = al_sfxr_getf(&data);
+
+    data++; /* filter_on, unused */
+
+    params->p_lpf_resonance = al_sfxr_getf(&data);
+    params->p_lpf_freq = al_sfxr_getf(&data);
+    params->p_lpf_ramp = al_sfxr_getf(&data);
+    params->p_hpf_freq = al_sfxr_getf(&data);
+    params->p_hpf_ramp = al_sfxr_getf(&data);
+
+    params->p_pha_offset = al_sfxr_getf(&data);
+    params->p_pha_ramp = al_sfxr_getf(&data);
+
+    params->p_repeat_speed = al_sfxr_getf(&data);
+
+    if (version >= 101) {
+        params->p_arp_speed = al_sfxr_getf(&data);
+        params->p_arp_mod = al_sfxr_getf(&data);
+    }
+}
+
+/* Returns the size of the SFXR at the start of the buffer, or 0 if it can't
+   be loaded */
+static size_t al_sfxr_loadsize(uint8_t const* data, size_t const size) {
+    if (size < 4) {
+        return 0;
+    }
+
+    size_t const file_size = al_sfxr_filesize(al_sfxr_get32(&data));
+    return file_size <= size ? file_size : 0;
+}
+
+int al_sfxr_load(al_sfxr_Params* const params, al_sfxr_Read8 const reader, void* const userdata) {
+    uint8_t data[105]; /* version 102, the largest */
+
+    for (size_t i = 0; i < 4; i++) {
+        int const res = reader(userdata, data + i);
+
+        if (res != 0) {
+            return res;
+        }
+    }
+
+    uint8_t const* version = data;
+    size_t const size = al_sfxr_filesize(al_sfxr_get32(&version));
+
+    if (size == 0) {
+        return -1;
+    }
+
+    for (size_t i = 4; i < size; i++) {
+        int const res = reader(userdata, data + i);
+
+        if (res != 0) {
+            return res;
+        }
+    }
+
+    al_sfxr_decode(params, data);
+    return 0;
+}
+
+int al_sfxr_load_mem(al_sfxr_Params* const params, void const* const data, size_t const size) {
+    if (al_sfxr_loadsize((uint8_t const*)data, size) == 0) {
+        return -1;
+    }
+
+    al_sfxr_decode(params, (uint8_t const*)data);
+    return 0;
+}
+
+size_t al_sfxr_load_mem_batch(al_sfxr_Params* const params, size_t const num_params, void const* const data,
+                              size_t const size, size_t* const used) {
+    uint8_t const* const bytes = (uint8_t const*)data;
+    size_t pos = 0, i = 0;
+
+    for (; i < num_params; i++) {
+        size_t const file_size = al_sfxr_loadsize(bytes + pos, size - pos);
+
+        if (file_size == 0) {
+            break;
+        }
+
+        al_sfxr_decode(params + i, bytes + pos);
+        pos += file_size;
+    }
+
+    if (used != NULL) {
+        *used = pos;
+    }
+
+    return i;
+}
+#endif /* AL_SFXR_LOAD */
+
+#if defined(AL_SFXR_GENERATE)
+static void al_sfxr_clamp_value(float* const value, int const bipolar) {
+    if (bipolar) {
+        if (*value < -1.0f) {
+            *value = -1.0f;
+        }
+    }
+    else {
+        if (*value < 0.0f) {
+            *value = 0.0f;
+        }
+    }
+
+    if (*value > 1.0f) {
+        *value = 1.0f;
+    }
+}
+
+static void al_sfxr_clamp(al_sfxr_Params* const params) {
+    al_sfxr_clamp_value(&params->p_base_freq, 0);
+    al_sfxr_clamp_value(&params->p_freq_ramp, 1);
+    al_sfxr_clamp_value(&params->p_freq_dramp, 1);
+    al_sfxr_clamp_value(&params->p_duty, 0);
+    al_sfxr_clamp_value(&params->p_duty_ramp, 1);
+    al_sfxr_clamp_value(&params->p_vib_strength, 0);
+    al_sfxr_clamp_value(&params->p_vib_speed, 0);
+    al_sfxr_clamp_value(&params->p_env_attack, 0);
+    al_sfxr_clamp_value(&params->p_env_sustain, 0);
+    al_sfxr_clamp_value(&params->p_env_decay, 0);
+    al_sfxr_clamp_value(&params->p_env_punch, 0);
+    al_sfxr_clamp_value(&params->p_lpf_resonance, 0);
+    al_sfxr_clamp_value(&params->p_lpf_freq, 0);
+    al_sfxr_clamp_value(&params->p_lpf_ramp, 1);
+    al_sfxr_clamp_value(&params->p_hpf_freq, 0);
+    al_sfxr_clamp_value(&params->p_hpf_ramp, 1);
+    al_sfxr_clamp_value(&params->p_pha_offset, 1);
+    al_sfxr_clamp_value(&params->p_pha_ramp, 1);
+    al_sfxr_clamp_value(&params->p_repeat_speed, 0);
+    al_sfxr_clamp_value(&params->p_arp_speed, 0);
+    al_sfxr_clamp_value(&params->p_arp_mod, 1);
+}
+
+static void al_sfxr_mutate(float* const value, al_sfxr_Prng* const prng) {
+    if (al_sfxr_randu(prng, 1)) {
+        *value += al_sfxr_randf(prng, 0.1f) - 0.05f;
+    }
+}
+
+void al_sfxr_generate(al_sfxr_Params* const params, al_sfxr_Preset const preset, unsigned const mutations, uint64_t const seed) {
+    static const al_sfxr_Wave wave_types[] = {
+        AL_SFXR_SQUARE,
+        AL_SFXR_SAWTOOTH,
+        AL_SFXR_SINEWAVE,
+        AL_SFXR_NOISE
+    };
+
+    al_sfxr_Prng prng;
+    al_sfxr_newprng(&prng, seed);
+
+    al_sfxr_zero(params);
+
+    switch (preset) {
+        case AL_SFXR_RANDOM:
+            params->wave_type = wave_types[al_sfxr_randu(&prng, 3)];
+            params->p_base_freq = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 2.0f);
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_base_freq = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f) + 0.5f;
+            }
+
+            params->p_freq_limit = 0.0f;
+            params->p_freq_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 5.0f);
+
+            if (params->p_base_freq > 0.7f && params->p_freq_ramp > 0.2f) {
+                params->p_freq_ramp = -params->p_freq_ramp;
+            }
+
+            if (params->p_base_freq < 0.2f && params->p_freq_ramp < -0.05f) {
+                params->p_freq_ramp = -params->p_freq_ramp;
+            }
+
+            params->p_freq_dramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
+            params->p_duty = al_sfxr_randf(&prng, 2.0f) - 1.0f;
+            params->p_duty_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
+            params->p_vib_strength = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
+            params->p_vib_speed = al_sfxr_randf(&prng, 2.0f) - 1.0f;
+            params->p_env_attack = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
+            params->p_env_sustain = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 2.0f);
+            params->p_env_decay = al_sfxr_randf(&prng, 2.0f) - 1.0f;
+            params->p_env_punch = pow(al_sfxr_randf(&prng, 0.8f), 2.0f);
+
+            if ((params->p_env_attack + params->p_env_sustain + params->p_env_decay) < 0.2f) {
+                params->p_env_sustain += 0.2f + al_sfxr_randf(&prng, 0.3f);
+                params->p_env_decay += 0.2f + al_sfxr_randf(&prng, 0.3f);
+            }
+
+            params->p_lpf_resonance = al_sfxr_randf(&prng, 2.0f) - 1.0f;
+            params->p_lpf_freq = 1.0f - pow(al_sfxr_randf(&prng, 1.0f), 3.0f);
+            params->p_lpf_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
+
+            if (params->p_lpf_freq < 0.1f && params->p_lpf_ramp < -0.05f) {
+                params->p_lpf_ramp = -params->p_lpf_ramp;
+            }
+
+            params->p_hpf_freq = pow(al_sfxr_randf(&prng, 1.0f), 5.0f);
+            params->p_hpf_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 5.0f);
+            params->p_pha_offset = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
+            params->p_pha_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
+            params->p_repeat_speed = al_sfxr_randf(&prng, 2.0f) - 1.0f;
+            params->p_arp_speed = al_sfxr_randf(&prng, 2.0f) - 1.0f;
+            params->p_arp_mod = al_sfxr_randf(&prng, 2.0f) - 1.0f;
+
+            break;
+
+        case AL_SFXR_PICKUP:
+            params->p_base_freq = 0.4f + al_sfxr_randf(&prng, 0.5f);
+            params->p_env_attack = 0.0f;
+            params->p_env_sustain = al_sfxr_randf(&prng, 0.1f);
+            params->p_env_decay = 0.1f + al_sfxr_randf(&prng, 0.4f);
+            params->p_env_punch = 0.3f + al_sfxr_randf(&prng, 0.3f);
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_arp_speed = 0.5f + al_sfxr_randf(&prng, 0.2f);
+                params->p_arp_mod = 0.2f + al_sfxr_randf(&prng, 0.4f);
+            }
+
+            break;
+
+        case AL_SFXR_LASER:
+            params->wave_type = wave_types[al_sfxr_randu(&prng, 2)];
+
+            if (params->wave_type == AL_SFXR_SINEWAVE && al_sfxr_randu(&prng, 1)) {
+                params->wave_type = wave_types[al_sfxr_randu(&prng, 1)];
+            }
+
+            params->p_base_freq = 0.5f + al_sfxr_randf(&prng, 0.5f);
+            params->p_freq_limit = params->p_base_freq - 0.2f - al_sfxr_randf(&prng, 0.6f);
+
+            if (params->p_freq_limit < 0.2f) {
+                params->p_freq_limit = 0.2f;
+            }
+
+            params->p_freq_ramp = -0.15f - al_sfxr_randf(&prng, 0.2f);
+
+            if (al_sfxr_randu(&prng, 2) == 0) {
+                params->p_base_freq = 0.3f + al_sfxr_randf(&prng, 0.6f);
+                params->p_freq_limit = al_sfxr_randf(&prng, 0.1f);
+                params->p_freq_ramp = -0.35f - al_sfxr_randf(&prng, 0.3f);
+            }
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_duty = al_sfxr_randf(&prng, 0.5f);
+                params->p_duty_ramp = al_sfxr_randf(&prng, 0.2f);
+            }
+            else {
+                params->p_duty = 0.4f + al_sfxr_randf(&prng, 0.5f);
+                params->p_duty_ramp = -al_sfxr_randf(&prng, 0.7f);
+            }
+
+            params->p_env_attack = 0.0f;
+            params->p_env_sustain = 0.1f + al_sfxr_randf(&prng, 0.2f);
+            params->p_env_decay = al_sfxr_randf(&prng, 0.4f);
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_env_punch = al_sfxr_randf(&prng, 0.3f);
+            }
+
+            if (al_sfxr_randu(&prng, 2) == 0) {
+                params->p_pha_offset = al_sfxr_randf(&prng, 0.2f);
+                params->p_pha_ramp = -al_sfxr_randf(&prng, 0.2f);
+            }
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_hpf_freq = al_sfxr_randf(&prng, 0.3f);
+            }
+
+            break;
+
+        case AL_SFXR_EXPLOSION:
+            params->wave_type = AL_SFXR_NOISE;
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_base_freq = 0.1f + al_sfxr_randf(&prng, 0.4f);
+                params->p_freq_ramp = -0.1f + al_sfxr_randf(&prng, 0.4f);
+            }
+            else {
+                params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.7f);
+                params->p_freq_ramp = -0.2f - al_sfxr_randf(&prng, 0.2f);
+            }
+
+            params->p_base_freq *= params->p_base_freq;
+
+            if (al_sfxr_randu(&prng, 4) == 0) {
+                params->p_freq_ramp=0.0f;
+            }
+
+            if (al_sfxr_randu(&prng, 2) == 0) {
+                params->p_repeat_speed = 0.3f + al_sfxr_randf(&prng, 0.5f);
+            }
+
+            params->p_env_attack = 0.0f;
+            params->p_env_sustain = 0.1f + al_sfxr_randf(&prng, 0.3f);
+            params->p_env_decay = al_sfxr_randf(&prng, 0.5f);
+
+            if (al_sfxr_randu(&prng, 1) == 0) {
+                params->p_pha_offset = -0.3f + al_sfxr_randf(&prng, 0.9f);
+                params->p_pha_ramp = -al_sfxr_randf(&prng, 0.3f);
+            }
+
+            params->p_env_punch = 0.2f + al_sfxr_randf(&prng, 0.6f);
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_vib_strength = al_sfxr_randf(&prng, 0.7f);
+                params->p_vib_speed = al_sfxr_randf(&prng, 0.6f);
+            }
+
+            if (al_sfxr_randu(&prng, 2) == 0) {
+                params->p_arp_speed = 0.6f + al_sfxr_randf(&prng, 0.3f);
+                params->p_arp_mod = 0.8f - al_sfxr_randf(&prng, 1.6f);
+            }
+
+            break;
+
+        case AL_SFXR_POWERUP:
+            if (al_sfxr_randu(&prng, 1)) {
+                params->wave_type = AL_SFXR_SAWTOOTH;
+            }
+            else {
+                params->p_duty = al_sfxr_randf(&prng, 0.6f);
+            }
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.3f);
+                params->p_freq_ramp = 0.1f + al_sfxr_randf(&prng, 0.4f);
+                params->p_repeat_speed = 0.4f + al_sfxr_randf(&prng, 0.4f);
+            }
+            else {
+                params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.3f);
+                params->p_freq_ramp = 0.05f + al_sfxr_randf(&prng, 0.2f);
+
+                if (al_sfxr_randu(&prng, 1)) {
+                    params->p_vib_strength = al_sfxr_randf(&prng, 0.7f);
+                    params->p_vib_speed = al_sfxr_randf(&prng, 0.6f);
+                }
+            }
+
+            params->p_env_attack = 0.0f;
+            params->p_env_sustain = al_sfxr_randf(&prng, 0.4f);
+            params->p_env_decay = 0.1f + al_sfxr_randf(&prng, 0.4f);
+            break;
+
+        case AL_SFXR_HIT:
+            params->wave_type = wave_types[al_sfxr_randu(&prng, 2)];
+
+            if (params->wave_type == AL_SFXR_SINEWAVE) {
+                params->wave_type = AL_SFXR_NOISE;
+            }
+
+            if (params->wave_type == AL_SFXR_SQUARE) {
+                params->p_duty = al_sfxr_randf(&prng, 0.6f);
+            }
+
+            params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.6f);
+            params->p_freq_ramp = -0.3f - al_sfxr_randf(&prng, 0.4f);
+            params->p_env_attack = 0.0f;
+            params->p_env_sustain = al_sfxr_randf(&prng, 0.1f);
+            params->p_env_decay = 0.1f + al_sfxr_randf(&prng, 0.2f);
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_hpf_freq = al_sfxr_randf(&prng, 0.3f);
+            }
+
+            break;
+
+        case AL_SFXR_JUMP:
+            params->wave_type = AL_SFXR_SQUARE;
+            params->p_duty = al_sfxr_randf(&prng, 0.6f);
+            params->p_base_freq = 0.3f + al_sfxr_randf(&prng, 0.3f);
+            params->p_freq_ramp = 0.1f + al_sfxr_randf(&prng, 0.2f);
+            params->p_env_attack = 0.0f;
+            params->p_env_sustain = 0.1f + al_sfxr_randf(&prng, 0.3f);
+            params->p_env_decay = 0.1f + al_sfxr_randf(&prng, 0.2f);
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_hpf_freq = al_sfxr_randf(&prng, 0.3f);
+            }
+
+            if (al_sfxr_randu(&prng, 1)) {
+                params->p_lpf_freq = 1.0f - al_sfxr_randf(&prng, 0.6f);
+            }
+
+            break;
+
+        case AL_SFXR_BLIP:
+            params->wave_type = wave_types[al_sfxr_randu(&prng, 1)];
+
+            if (params->wave_type == AL_SFXR_SQUARE) {
+                params->p_duty = al_sfxr_randf(&prng, 0.6f);
+            }
+
+            params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.4f);
+            params->p_env_attack = 0.0f;
+            params->p_env_sustain = 0.1f + al_sfxr_randf(&prng, 0.1f);
+            params->p_env_decay = al_sfxr_randf(&prng, 0.2f);
+            params->p_hpf_freq = 0.1f;
+
+            break;
+    }
+
+    al_sfxr_clamp(params);
+
+    for (unsigned i = 0; i < mutations; i++) {
+        al_sfxr_mutate(&params->p_base_freq, &prng);
+        al_sfxr_mutate(&params->p_freq_ramp, &prng);
+        al_sfxr_mutate(&params->p_freq_dramp, &prng);
+        al_sfxr_mutate(&params->p_duty, &prng);
+        al_sfxr_mutate(&params->p_duty_ramp, &prng);
+        al_sfxr_mutate(&params->p_vib_strength, &prng);
+        al_sfxr_mutate(&params->p_vib_speed, &prng);
+        al_sfxr_mutate(&params->p_env_attack, &prng);
+        al_sfxr_mutate(&params->p_env_sustain, &prng);
+        al_sfxr_mutate(&params->p_env_decay, &prng);
+        al_sfxr_mutate(&params->p_env_punch, &prng);
+        al_sfxr_mutate(&params->p_lpf_resonance, &prng);
+        al_sfxr_mutate(&params->p_lpf_freq, &prng);
+        al_sfxr_mutate(&params->p_lpf_ramp, &prng);
+        al_sfxr_mutate(&params->p_hpf_freq, &prng);
+        al_sfxr_mutate(&params->p_hpf_ramp, &prng);
+        al_sfxr_mutate(&params->p_pha_offset, &prng);
+        al_sfxr_mutate(&params->p_pha_ramp, &prng);
+        al_sfxr_mutate(&params->p_repeat_speed, &prng);
+        al_sfxr_mutate(&params->p_arp_speed, &prng);
+        al_sfxr_mutate(&params->p_arp_mod, &prng);
+
+        al_sfxr_clamp(params);
+    }
+}
+#endif /* AL_SFXR_GENERATE */
+
+#if defined(AL_SFXR_SAVE)
+/* Little-endian writes to a buffer that advance it */
+static void al_sfxr_put32(uint8_t** const data, uint32_t const value) {
+    uint8_t* const p = *data;
+    *data = p + 4;
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static void al_sfxr_putf(uint8_t** const data, float const value) {
+    uint32_t dword;
+    memcpy((void*)&dword, (void const*)&value, sizeof(dword));
+    al_sfxr_put32(data, dword);
+}
+
+/* Encodes a SFXR as a version 102 file of AL_SFXR_SAVE_SIZE bytes */
+static void al_sfxr_encode(al_sfxr_Params const* const params, uint8_t* data) {
+    al_sfxr_put32(&data, 102); /* version */
+    al_sfxr_put32(&data, (uint32_t)params->wave_type);
+
+    al_sfxr_putf(&data, params->sound_vol);
+
+    al_sfxr_putf(&data, params->p_base_freq);
+    al_sfxr_putf(&data, params->p_freq_limit);
+    al_sfxr_putf(&data, params->p_freq_ramp);
+    al_sfxr_putf(&data, params->p_freq_dramp);
+    al_sfxr_putf(&data, params->p_duty);
+    al_sfxr_putf(&data, params->p_duty_ramp);
+
+    al_sfxr_putf(&data, params->p_vib_strength);
+    al_sfxr_putf(&data, params->p_vib_speed);
+    al_sfxr_putf(&data, 0.0f); /* vib_delay, unused */
+
+    al_sfxr_putf(&data, params->p_env_attack);
+    al_sfxr_putf(&data, params->p_env_sustain);
+    al_sfxr_putf(&data, params->p_env_decay);
+    al_sfxr_putf(&data, params->p_env_punch);
+
+    *data++ = 0; /* filter_on, unused */
+
+    al_sfxr_putf(&data, params->p_lpf_resonance);
+    al_sfxr_putf(&data, params->p_lpf_freq);
+    al_sfxr_putf(&data, params->p_lpf_ramp);
+    al_sfxr_putf(&data, params->p_hpf_freq);
+    al_sfxr_putf(&data, params->p_hpf_ramp);
+
+    al_sfxr_putf(&data, params->p_pha_offset);
+    al_sfxr_putf(&data, params->p_pha_ramp);
+
+    al_sfxr_putf(&data, params->p_repeat_speed);
+
+    al_sfxr_putf(&data, params->p_arp_speed);
+    al_sfxr_putf(&data, params->p_arp_mod);
+}
+
+int al_sfxr_save(al_sfxr_Params const* const params, al_sfxr_Write8 const writer, void* const userdata) {
+    uint8_t data[AL_SFXR_SAVE_SIZE];
+    al_sfxr_encode(params, data);
+
+    for (size_t i = 0; i < AL_SFXR_SAVE_SIZE; i++) {
+        int const res = writer(userdata, data[i]);
+
+        if (res != 0) {
+            return res;
+        }
+    }
+
+    return 0;
+}
+
+size_t al_sfxr_save_mem(al_sfxr_Params const* const params, void* const data, size_t const size) {
+    if (size < AL_SFXR_SAVE_SIZE) {
+        return 0;
+    }
+
+    al_sfxr_encode(params, (uint8_t*)data);
+    return AL_SFXR_SAVE_SIZE;
+}
+#endif /* AL_SFXR_SAVE */
+
+#if defined(AL_SFXR_MIXER) || (defined(AL_SFXR_BANK) && defined(AL_SFXR_GENERATE))
+/* Atomic operations used by the queues, the voice ids, and the memoization
+   tables of seed banks, acquire on loads and release on stores */
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+static unsigned al_sfxr_atomic_load(unsigned volatile* const value) {
+    return (unsigned)_InterlockedOr((long volatile*)value, 0);
+}
+
+static void al_sfxr_atomic_store(unsigned volatile* const value, unsigned const desired) {
+    _InterlockedExchange((long volatile*)value, (long)desired);
+}
+
+static int al_sfxr_atomic_cas(unsigned volatile* const value, unsigned const expected, unsigned const desired) {
+    return (unsigned)_InterlockedCompareExchange((long volatile*)value, (long)desired, (long)expected) == expected;
+}
+
+#if defined(AL_SFXR_MIXER)
+static unsigned al_sfxr_atomic_inc(unsigned volatile* const value) {
+    return (unsigned)_InterlockedIncrement((long volatile*)value) - 1;
+}
+#endif
+#else
+static unsigned al_sfxr_atomic_load(unsigned volatile* const value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void al_sfxr_atomic_store(unsigned volatile* const value, unsigned const desired) {
+    __atomic_store_n(value, desired, __ATOMIC_RELEASE);
+}
+
+static int al_sfxr_atomic_cas(unsigned volatile* const value, unsigned expected, unsigned const desired) {
+    return __atomic_compare_exchange_n(value, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+#if defined(AL_SFXR_MIXER)
+static unsigned al_sfxr_atomic_inc(unsigned volatile* const value) {
+    return __atomic_fetch_add(value, 1, __ATOMIC_RELAXED);
+}
+#endif
+#endif
+#endif /* AL_SFXR_MIXER || (AL_SFXR_BANK && AL_SFXR_GENERATE) */
+
+#if defined(AL_SFXR_BANK)
+#define AL_SFXR_BANK_HEADER 32
+#define AL_SFXR_BANK_ALIGN 64
+
+/* Offset of the records in a bank, after the header and the index */
+static size_t al_sfxr_bank_records(size_t const count) {
+    size_t const end = AL_SFXR_BANK_HEADER + count * sizeof(al_sfxr_BankEntry);
+    return (end + AL_SFXR_BANK_ALIGN - 1) & ~(size_t)(AL_SFXR_BANK_ALIGN - 1);
+}
+
+static void al_sfxr_bank_put32(uint8_t* const data, uint32_t const value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t al_sfxr_bank_get32(uint8_t const* const data) {
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static int al_sfxr_bank_compare(void const* const a, void const* const b) {
+    uint32_t const id_a = ((al_sfxr_BankEntry const*)a)->id;
+    uint32_t const id_b = ((al_sfxr_BankEntry const*)b)->id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+/* Writes the header and the sorted index of a bank of records of the given
+   size, and returns the offset of the records, or 0 if there are duplicated
+   ids */
+static size_t al_sfxr_bank_begin(uint8_t* const bytes, char const* const magic, size_t const record_size,
+                                 uint32_t const* const ids, size_t const count) {
+    size_t const records = al_sfxr_bank_records(count);
+
+    memset((void*)bytes, 0, records);
+    memcpy((void*)bytes, (void const*)magic, 4);
+    al_sfxr_bank_put32(bytes + 4, AL_SFXR_BANK_VERSION);
+    al_sfxr_bank_put32(bytes + 8, (uint32_t)count);
+    al_sfxr_bank_put32(bytes + 12, (uint32_t)record_size);
+    al_sfxr_bank_put32(bytes + 16, AL_SFXR_BANK_HEADER);
+    al_sfxr_bank_put32(bytes + 20, (uint32_t)records);
+
+    /* Entries are written in native order, checked to be little-endian when
+       the bank is opened */
+    al_sfxr_BankEntry* const index = (al_sfxr_BankEntry*)(bytes + AL_SFXR_BANK_HEADER);
+
+    for (size_t i = 0; i < count; i++) {
+        index[i].id = ids[i];
+        index[i].record = (uint32_t)i;
+    }
+
+    qsort(index, count, sizeof(*index), al_sfxr_bank_compare);
+
+    for (size_t i = 1; i < count; i++) {
+        if (index[i].id == index[i - 1].id) {
+            return 0;
+        }
+    }
+
+    return records;
+}
+
+/* Checks the header of a bank of records of the given size, and returns the
+   offset of the records, or 0 if the bank can't be opened */
+static size_t al_sfxr_bank_check(uint8_t const* const bytes, size_t const size, char const* const magic,
+                                 size_t const record_size, uint32_t* const count) {
+    uint32_t const one = 1;
+
+    if (size < AL_SFXR_BANK_HEADER || ((uintptr_t)bytes & 3) != 0 || *(uint8_t const*)&one != 1 ||
+        memcmp((void const*)bytes, (void const*)magic, 4) != 0 ||
+        al_sfxr_bank_get32(bytes + 4) != AL_SFXR_BANK_VERSION || al_sfxr_bank_get32(bytes + 12) != record_size) {
+        return 0;
+    }
+
+    *count = al_sfxr_bank_get32(bytes + 8);
+    size_t const index = al_sfxr_bank_get32(bytes + 16);
+    size_t const records = al_sfxr_bank_get32(bytes + 20);
+
+    /* The first check keeps the sizes from overflowing */
+    if (*count > size / record_size || index != AL_SFXR_BANK_HEADER || records != al_sfxr_bank_records(*count) ||
+        records + *count * record_size > size) {
+        return 0;
+    }
+
+    return records;
+}
+
+/* Branchless search for the last entry with an id less than or equal to the
+   one being searched, the compiler uses a conditional move instead of a
+   branch that mispredicts half of the time. Returns the record of the id, or
+   count if it's not in the index */
+static uint32_t al_sfxr_bank_search(al_sfxr_BankEntry const* entry, uint32_t const count, uint32_t const id) {
+    size_t left = count;
+
+    if (left == 0) {
+        return count;
+    }
+
+    while (left > 1) {
+        size_t const half = left / 2;
+        entry = entry[half].id <= id ? entry + half : entry;
+        left -= half;
+    }
+
+    return entry->id == id && entry->record < count ? entry->record : count;
+}
+
+uint32_t al_sfxr_bank_hash(char const* const name) {
+    uint32_t hash = UINT32_C(0x811c9dc5);
+
+    for (char const* c = name; *c != 0; c++) {
+        hash = (hash ^ (uint8_t)*c) * UINT32_C(0x01000193);
+    }
+
+    return hash;
+}
+
+size_t al_sfxr_bank_size(size_t const count) {
+    return al_sfxr_bank_records(count) + count * sizeof(al_sfxr_Params);
+}
+
+size_t al_sfxr_bank_write(void* const data, size_t const size, al_sfxr_Params const* const params,
+                          uint32_t const* const ids, size_t const count) {
+    uint8_t* const bytes = (uint8_t*)data;
+
+    if (size < al_sfxr_bank_size(count) || count > UINT32_MAX) {
+        return 0;
+    }
+
+    size_t const records = al_sfxr_bank_begin(bytes, "SFXB", sizeof(al_sfxr_Params), ids, count);
+
+    if (records == 0) {
+        return 0;
+    }
+
+    memcpy((void*)(bytes + records), (void const*)params, count * sizeof(al_sfxr_Params));
+    return al_sfxr_bank_size(count);
+}
+
+int al_sfxr_bank_open(al_sfxr_Bank* const bank, void const* const data, size_t const size) {
+    uint8_t const* const bytes = (uint8_t const*)data;
+    uint32_t count = 0;
+    size_t const records = al_sfxr_bank_check(bytes, size, "SFXB", sizeof(al_sfxr_Params), &count);
+
+    if (records == 0 || sizeof(al_sfxr_Wave) != 4) {
+        return -1;
+    }
+
+    bank->index = (al_sfxr_BankEntry const*)(bytes + AL_SFXR_BANK_HEADER);
+    bank->params = (al_sfxr_Params const*)(bytes + records);
+    bank->count = count;
+    return 0;
+}
+
+al_sfxr_Params const* al_sfxr_bank_find(al_sfxr_Bank const* const bank, uint32_t const id) {
+    uint32_t const record = al_sfxr_bank_search(bank->index, bank->count, id);
+    return record < bank->count ? bank->params + record : NULL;
+}
+
+#if defined(AL_SFXR_GENERATE)
+#define AL_SFXR_SEED_RECORD 16
+
+/* States of the slots of a seed bank's memoization table */
+#define AL_SFXR_SLOT_EMPTY 0
+#define AL_SFXR_SLOT_BUSY 1
+#define AL_SFXR_SLOT_READY 2
+
+/* The only flag of a seed record, set when it replaces the generated volume */
+#define AL_SFXR_SEED_VOLUME 1
+
+/* Generates the parameters of a record of a seed bank */
+static void al_sfxr_seedbank_decode(al_sfxr_SeedBank const* const bank, uint32_t const record,
+                                    al_sfxr_Params* const params) {
+    al_sfxr_Seed seed;
+    al_sfxr_seedbank_seed(bank, record, &seed);
+    al_sfxr_generate(params, seed.preset, seed.mutations, seed.seed);
+
+    if (seed.volume >= 0.0f) {
+        params->sound_vol = seed.volume;
+    }
+}
+
+/* Generates a record into its slot unless it's already there or another
+   thread is doing it, returns 1 if it was generated */
+static int al_sfxr_seedbank_fill(al_sfxr_SeedBank* const bank, uint32_t const record) {
+    al_sfxr_SeedSlot* const slot = bank->slots + record;
+
+    if (al_sfxr_atomic_load(&slot->state) != AL_SFXR_SLOT_EMPTY ||
+        !al_sfxr_atomic_cas(&slot->state, AL_SFXR_SLOT_EMPTY, AL_SFXR_SLOT_BUSY)) {
+        return 0;
+    }
+
+    al_sfxr_seedbank_decode(bank, record, &slot->params);
+    al_sfxr_atomic_store(&slot->state, AL_SFXR_SLOT_READY);
+    return 1;
+}
+
+size_t al_sfxr_seedbank_size(size_t const count) {
+    return al_sfxr_bank_records(count) + count * AL_SFXR_SEED_RECORD;
+}
+
+size_t al_sfxr_seedbank_write(void* const data, size_t const size, al_sfxr_Seed const* const seeds,
+                              uint32_t const* const ids, size_t const count) {
+    uint8_t* const bytes = (uint8_t*)data;
+
+    if (size < al_sfxr_seedbank_size(count) || count > UINT32_MAX) {
+        return 0;
+    }
+
+    size_t const records = al_sfxr_bank_begin(bytes, "SFXS", AL_SFXR_SEED_RECORD, ids, count);
+
+    if (records == 0) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        al_sfxr_Seed const* const seed = seeds + i;
+        uint8_t* const record = bytes + records + i * AL_SFXR_SEED_RECORD;
+
+        if ((unsigned)seed->preset > AL_SFXR_BLIP || seed->mutations > 0xffff) {
+            return 0;
+        }
+
+        uint32_t volume;
+        memcpy((void*)&volume, (void const*)&seed->volume, sizeof(volume));
+
+        al_sfxr_bank_put32(record, (uint32_t)seed->seed);
+        al_sfxr_bank_put32(record + 4, (uint32_t)(seed->seed >> 32));
+        al_sfxr_bank_put32(record + 8, seed->volume >= 0.0f ? volume : 0);
+        record[12] = (uint8_t)seed->mutations;
+        record[13] = (uint8_t)(seed->mutations >> 8);
+        record[14] = (uint8_t)seed->preset;
+        record[15] = seed->volume >= 0.0f ? AL_SFXR_SEED_VOLUME : 0;
+    }
+
+    return al_sfxr_seedbank_size(count);
+}
+
+int al_sfxr_seedbank_open(al_sfxr_SeedBank* const bank, void const* const data, size_t const size) {
+    uint8_t const* const bytes = (uint8_t const*)data;
+    uint32_t count = 0;
+    size_t const records = al_sfxr_bank_check(bytes, size, "SFXS", AL_SFXR_SEED_RECORD, &count);
+
+    if (records == 0) {
+        return -1;
+    }
+
+    bank->index = (al_sfxr_BankEntry const*)(bytes + AL_SFXR_BANK_HEADER);
+    bank->records = bytes + records;
+    bank->count = count;
+    bank->slots = NULL;
+
+    /* Checked once here so that decoding never sees an invalid record */
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t const* const record = bank->records + (size_t)i * AL_SFXR_SEED_RECORD;
+        al_sfxr_Seed seed;
+        al_sfxr_seedbank_seed(bank, i, &seed);
+
+        if (record[14] > AL_SFXR_BLIP || (record[15] & ~AL_SFXR_SEED_VOLUME) != 0 ||
+            ((record[15] & AL_SFXR_SEED_VOLUME) != 0 && !(seed.volume >= 0.0f))) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void al_sfxr_seedbank_seed(al_sfxr_SeedBank const* const bank, uint32_t const record, al_sfxr_Seed* const seed) {
+    uint8_t const* const data = bank->records + (size_t)record * AL_SFXR_SEED_RECORD;
+    uint32_t const volume = al_sfxr_bank_get32(data + 8);
+
+    seed->preset = (al_sfxr_Preset)data[14];
+    seed->mutations = (unsigned)data[12] | (unsigned)data[13] << 8;
+    seed->seed = (uint64_t)al_sfxr_bank_get32(data) | (uint64_t)al_sfxr_bank_get32(data + 4) << 32;
+
+    if ((data[15] & AL_SFXR_SEED_VOLUME) != 0) {
+        memcpy((void*)&seed->volume, (void const*)&volume, sizeof(seed->volume));
+    }
+    else {
+        seed->volume = -1.0f;
+    }
+}
+
+void al_sfxr_seedbank_memoize(al_sfxr_SeedBank* const bank, al_sfxr_SeedSlot* const slots) {
+    bank->slots = slots;
+}
+
+al_sfxr_Params const* al_sfxr_seedbank_find(al_sfxr_SeedBank* const bank, uint32_t const id,
+                                            al_sfxr_Params* const params) {
+    uint32_t const record = al_sfxr_bank_search(bank->index, bank->count, id);
+
+    if (record >= bank->count) {
+        return NULL;
+    }
+
+    if (bank->slots != NULL) {
+        al_sfxr_SeedSlot* const slot = bank->slots + record;
+
+        if (al_sfxr_atomic_load(&slot->state) == AL_SFXR_SLOT_READY || al_sfxr_seedbank_fill(bank, record)) {
+            return &slot->params;
+        }
+    }
+
+    al_sfxr_seedbank_decode(bank, record, params);
+    return params;
+}
+
+size_t al_sfxr_seedbank_generate(al_sfxr_SeedBank* const bank, size_t const first, size_t const count) {
+    size_t const end = first + count < bank->count ? first + count : bank->count;
+    size_t generated = 0;
+
+    for (size_t record = first; record < end; record++) {
+        generated += (size_t)al_sfxr_seedbank_fill(bank, (uint32_t)record);
+    }
+
+    return generated;
+}
+#endif /* AL_SFXR_GENERATE */
+#endif /* AL_SFXR_BANK */
+
+#if defined(AL_SFXR_QUANTIZE)
+#define AL_SFXR_QUANTIZE_FIELDS 24
+
+#if !defined(AL_SFXR_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define AL_SFXR_QUANTIZE_SSE2
+#endif
+
+/* The range of each field, in the order of al_sfxr_Params, and the scale and
+   bias that map it to integers. The bias puts zero at the middle of the
+   range of bipolar fields, so that it's exact */
+static float const al_sfxr_quant_min[AL_SFXR_QUANTIZE_FIELDS] = {
+    0.0f,                                   /* wave_type */
+    0.0f, 0.0f, -1.0f, -1.0f, 0.0f, -1.0f,  /* base_freq to duty_ramp */
+    0.0f, 0.0f,                             /* vib_strength, vib_speed */
+    0.0f, 0.0f, 0.0f, 0.0f,                 /* env_attack to env_punch */
+    0.0f, 0.0f, -1.0f, 0.0f, -1.0f,         /* lpf_resonance to hpf_ramp */
+    -1.0f, -1.0f,                           /* pha_offset, pha_ramp */
+    0.0f,                                   /* repeat_speed */
+    0.0f, -1.0f,                            /* arp_speed, arp_mod */
+    0.0f                                    /* sound_vol */
+};
+
+static float const al_sfxr_quant_max[AL_SFXR_QUANTIZE_FIELDS] = {
+    3.0f,
+    1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+    1.0f, 1.0f,
+    1.0f, 1.0f, 1.0f, 1.0f,
+    1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+    1.0f, 1.0f,
+    1.0f,
+    1.0f, 1.0f,
+    1.0f
+};
+
+typedef struct {
+    float scale[AL_SFXR_QUANTIZE_FIELDS];
+    float bias[AL_SFXR_QUANTIZE_FIELDS];
+}
+al_sfxr_Quantizer;
+
+static al_sfxr_Quantizer const al_sfxr_quant8 = {
+    {
+        1.0f,
+        255.0f, 255.0f, 127.0f, 127.0f, 255.0f, 127.0f,
+        255.0f, 255.0f,
+        255.0f, 255.0f, 255.0f, 255.0f,
+        255.0f, 255.0f, 127.0f, 255.0f, 127.0f,
+        127.0f, 127.0f,
+        255.0f,
+        255.0f, 127.0f,
+        255.0f
+    },
+    {
+        0.0f,
+        0.0f, 0.0f, 128.0f, 128.0f, 0.0f, 128.0f,
+        0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 128.0f, 0.0f, 128.0f,
+        128.0f, 128.0f,
+        0.0f,
+        0.0f, 128.0f,
+        0.0f
+    }
+};
+
+static al_sfxr_Quantizer const al_sfxr_quant16 = {
+    {
+        1.0f,
+        65535.0f, 65535.0f, 32767.0f, 32767.0f, 65535.0f, 32767.0f,
+        65535.0f, 65535.0f,
+        65535.0f, 65535.0f, 65535.0f, 65535.0f,
+        65535.0f, 65535.0f, 32767.0f, 65535.0f, 32767.0f,
+        32767.0f, 32767.0f,
+        65535.0f,
+        65535.0f, 32767.0f,
+        65535.0f
+    },
+    {
+        0.0f,
+        0.0f, 0.0f, 32768.0f, 32768.0f, 0.0f, 32768.0f,
+        0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 32768.0f, 0.0f, 32768.0f,
+        32768.0f, 32768.0f,
+        0.0f,
+        0.0f, 32768.0f,
+        0.0f
+    }
+};
+
+/* Maps a frequency parameter in [0, 1] to [0, 1] on a log scale of its
+   period, 100 / (p * p + 0.001), so that rounding it changes the pitch by
+   the same ratio everywhere instead of a semitone near 0.03. NaNs and
+   negative values become 0 */
+static float al_sfxr_freq_to_field(float const p) {
+    return p > 0.0f ? (float)(log(1000.0 * p * p + 1.0) / log(1001.0)) : 0.0f;
+}
+
+static float al_sfxr_field_to_freq(float const field) {
+    return field > 0.0f ? (float)sqrt((exp(field * log(1001.0)) - 1.0) / 1000.0) : 0.0f;
+}
+
+static void al_sfxr_getfields(float* const fields, al_sfxr_Params const* const params) {
+    fields[0] = (float)params->wave_type;
+
+    fields[1] = al_sfxr_freq_to_field(params->p_base_freq);
+    fields[2] = al_sfxr_freq_to_field(params->p_freq_limit);
+    fields[3] = params->p_freq_ramp;
+    fields[4] = params->p_freq_dramp;
+    fields[5] = params->p_duty;
+    fields[6] = params->p_duty_ramp;
+
+    fields[7] = params->p_vib_strength;
+    fields[8] = params->p_vib_speed;
+
+    fields[9] = params->p_env_attack;
+    fields[10] = params->p_env_sustain;
+    fields[11] = params->p_env_decay;
+    fields[12] = params->p_env_punch;
+
+    fields[13] = params->p_lpf_resonance;
+    fields[14] = params->p_lpf_freq;
+    fields[15] = params->p_lpf_ramp;
+    fields[16] = params->p_hpf_freq;
+    fields[17] = params->p_hpf_ramp;
+
+    fields[18] = params->p_pha_offset;
+    fields[19] = params->p_pha_ramp;
+
+    fields[20] = params->p_repeat_speed;
+
+    fields[21] = params->p_arp_speed;
+    fields[22] = params->p_arp_mod;
+
+    fields[23] = params->sound_vol;
+}
+
+static void al_sfxr_setfields(al_sfxr_Params* const params, float const* const fields) {
+    params->wave_type = (al_sfxr_Wave)(int)fields[0];
+
+    params->p_base_freq = al_sfxr_field_to_freq(fields[1]);
+    params->p_freq_limit = al_sfxr_field_to_freq(fields[2]);
+    params->p_freq_ramp = fields[3];
+    params->p_freq_dramp = fields[4];
+    params->p_duty = fields[5];
+    params->p_duty_ramp = fields[6];
+
+    params->p_vib_strength = fields[7];
+    params->p_vib_speed = fields[8];
+
+    params->p_env_attack = fields[9];
+    params->p_env_sustain = fields[10];
+    params->p_env_decay = fields[11];
+    params->p_env_punch = fields[12];
+
+    params->p_lpf_resonance = fields[13];
+    params->p_lpf_freq = fields[14];
+    params->p_lpf_ramp = fields[15];
+    params->p_hpf_freq = fields[16];
+    params->p_hpf_ramp = fields[17];
+
+    params->p_pha_offset = fields[18];
+    params->p_pha_ramp = fields[19];
+
+    params->p_repeat_speed = fields[20];
+
+    params->p_arp_speed = fields[21];
+    params->p_arp_mod = fields[22];
+
+    params->sound_vol = fields[23];
+}
+
+#if defined(AL_SFXR_QUANTIZE_SSE2)
+/* Quantizes 4 fields starting at i, rounding to nearest even like lrintf */
+static AL_SFXR_INLINE __m128i al_sfxr_quantize4(float const* const fields, al_sfxr_Quantizer const* const quant,
+                                                size_t const i) {
+    __m128 value = _mm_loadu_ps(fields + i);
+    value = _mm_max_ps(value, _mm_loadu_ps(al_sfxr_quant_min + i));
+    value = _mm_min_ps(value, _mm_loadu_ps(al_sfxr_quant_max + i));
+    value = _mm_add_ps(_mm_mul_ps(value, _mm_loadu_ps(quant->scale + i)), _mm_loadu_ps(quant->bias + i));
+    return _mm_cvtps_epi32(value);
+}
+
+static AL_SFXR_INLINE void al_sfxr_dequantize4(float* const fields, __m128i const q,
+                                               al_sfxr_Quantizer const* const quant, size_t const i) {
+    __m128 const value = _mm_sub_ps(_mm_cvtepi32_ps(q), _mm_loadu_ps(quant->bias + i));
+    _mm_storeu_ps(fields + i, _mm_div_ps(value, _mm_loadu_ps(quant->scale + i)));
+}
+#else
+/* NaNs fail both comparisons and become the minimum, as with _mm_max_ps */
+static int32_t al_sfxr_quantize(float const* const fields, al_sfxr_Quantizer const* const quant, size_t const i) {
+    float value = fields[i] > al_sfxr_quant_min[i] ? fields[i] : al_sfxr_quant_min[i];
+    value = value < al_sfxr_quant_max[i] ? value : al_sfxr_quant_max[i];
+    return (int32_t)lrintf(value * quant->scale[i] + quant->bias[i]);
+}
+
+static float al_sfxr_dequantize(int32_t const q, al_sfxr_Quantizer const* const quant, size_t const i) {
+    return ((float)q - quant->bias[i]) / quant->scale[i];
+}
+#endif /* AL_SFXR_QUANTIZE_SSE2 */
+
+void al_sfxr_pack8(al_sfxr_Params8* const packed, al_sfxr_Params const* const params, size_t const count) {
+    for (size_t k = 0; k < count; k++) {
+        float fields[AL_SFXR_QUANTIZE_FIELDS];
+        al_sfxr_getfields(fields, params + k);
+
+#if defined(AL_SFXR_QUANTIZE_SSE2)
+        __m128i const lo = _mm_packs_epi32(al_sfxr_quantize4(fields, &al_sfxr_quant8, 0),
+                                           al_sfxr_quantize4(fields, &al_sfxr_quant8, 4));
+
+        __m128i const mid = _mm_packs_epi32(al_sfxr_quantize4(fields, &al_sfxr_quant8, 8),
+                                            al_sfxr_quantize4(fields, &al_sfxr_quant8, 12));
+
+        __m128i const hi = _mm_packs_epi32(al_sfxr_quantize4(fields, &al_sfxr_quant8, 16),
+                                           al_sfxr_quantize4(fields, &al_sfxr_quant8, 20));
+
+        _mm_storeu_si128((__m128i*)packed[k].fields, _mm_packus_epi16(lo, mid));
+        _mm_storel_epi64((__m128i*)(packed[k].fields + 16), _mm_packus_epi16(hi, hi));
+#else
+        for (size_t i = 0; i < AL_SFXR_QUANTIZE_FIELDS; i++) {
+            packed[k].fields[i] = (uint8_t)al_sfxr_quantize(fields, &al_sfxr_quant8, i);
+        }
+#endif
+    }
+}
+
+void al_sfxr_unpack8(al_sfxr_Params* const params, al_sfxr_Params8 const* const packed, size_t const count) {
+    for (size_t k = 0; k < count; k++) {
+        float fields[AL_SFXR_QUANTIZE_FIELDS];
+
+#if defined(AL_SFXR_QUANTIZE_SSE2)
+        __m128i const zero = _mm_setzero_si128();
+        __m128i const bytes = _mm_loadu_si128((__m128i const*)packed[k].fields);
+        __m128i const lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i const mid = _mm_unpackhi_epi8(bytes, zero);
+        __m128i const hi = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const*)(packed[k].fields + 16)), zero);
+
+        al_sfxr_dequantize4(fields, _mm_unpacklo_epi16(lo, zero), &al_sfxr_quant8, 0);
+        al_sfxr_dequantize4(fields, _mm_unpackhi_epi16(lo, zero), &al_sfxr_quant8, 4);
+        al_sfxr_dequantize4(fields, _mm_unpacklo_epi16(mid, zero), &al_sfxr_quant8, 8);
+        al_sfxr_dequantize4(fields, _mm_unpackhi_epi16(mid, zero), &al_sfxr_quant8, 12);
+        al_sfxr_dequantize4(fields, _mm_unpacklo_epi16(hi, zero), &al_sfxr_quant8, 16);
+        al_sfxr_dequantize4(fields, _mm_unpackhi_epi16(hi, zero), &al_sfxr_quant8, 20);
+#else
+        for (size_t i = 0; i < AL_SFXR_QUANTIZE_FIELDS; i++) {
+            fields[i] = al_sfxr_dequantize(packed[k].fields[i], &al_sfxr_quant8, i);
+        }
+#endif
+
+        al_sfxr_setfields(params + k, fields);
+    }
+}
+
+void al_sfxr_pack16(al_sfxr_Params16* const packed, al_sfxr_Params const* const params, size_t const count) {
+#if defined(AL_SFXR_QUANTIZE_SSE2)
+    /* SSE2 only packs with signed saturation, so the values are moved to the
+       signed range and back */
+    __m128i const offset = _mm_set1_epi32(32768);
+    __m128i const sign = _mm_set1_epi16((short)0x8000);
+#endif
+
+    for (size_t k = 0; k < count; k++) {
+        float fields[AL_SFXR_QUANTIZE_FIELDS];
+        al_sfxr_getfields(fields, params + k);
+
+#if defined(AL_SFXR_QUANTIZE_SSE2)
+        for (size_t i = 0; i < AL_SFXR_QUANTIZE_FIELDS; i += 8) {
+            __m128i const lo = _mm_sub_epi32(al_sfxr_quantize4(fields, &al_sfxr_quant16, i), offset);
+            __m128i const hi = _mm_sub_epi32(al_sfxr_quantize4(fields, &al_sfxr_quant16, i + 4), offset);
+            _mm_storeu_si128((__m128i*)(packed[k].fields + i), _mm_xor_si128(_mm_packs_epi32(lo, hi), sign));
+        }
+#else
+        for (size_t i = 0; i < AL_SFXR_QUANTIZE_FIELDS; i++) {
+            packed[k].fields[i] = (uint16_t)al_sfxr_quantize(fields, &al_sfxr_quant16, i);
+        }
+#endif
+    }
+}
+
+void al_sfxr_unpack16(al_sfxr_Params* const params, al_sfxr_Params16 const* const packed, size_t const count) {
+    for (size_t k = 0; k < count; k++) {
+        float fields[AL_SFXR_QUANTIZE_FIELDS];
+
+#if defined(AL_SFXR_QUANTIZE_SSE2)
+        __m128i const zero = _mm_setzero_si128();
+
+        for (size_t i = 0; i < AL_SFXR_QUANTIZE_FIELDS; i += 8) {
+            __m128i const words = _mm_loadu_si128((__m128i const*)(packed[k].fields + i));
+            al_sfxr_dequantize4(fields, _mm_unpacklo_epi16(words, zero), &al_sfxr_quant16, i);
+            al_sfxr_dequantize4(fields, _mm_unpackhi_epi16(words, zero), &al_sfxr_quant16, i + 4);
+        }
+#else
+        for (size_t i = 0; i < AL_SFXR_QUANTIZE_FIELDS; i++) {
+            fields[i] = al_sfxr_dequantize(packed[k].fields[i], &al_sfxr_quant16, i);
+        }
+#endif
+
+        al_sfxr_setfields(params + k, fields);
+    }
+}
+#endif /* AL_SFXR_QUANTIZE */
+
+void al_sfxr_compile(al_sfxr_Patch* const patch, al_sfxr_Params const* const params) {
+    al_sfxr_compile_rate(patch, params, 44100);
+}
+
+void al_sfxr_compile_rate(al_sfxr_Patch* const patch, al_sfxr_Params const* const params,
+                          unsigned const sample_rate) {
+    al_sfxr_compile_ex(patch, params, sample_rate, 8);
+}
+
+/* Rescales the coefficient of a one-pole filter, which keeps 1 - c of its
+   state every step, to steps n times as long */
+static float al_sfxr_onepole(float const c, double const n) {
+    return (float)(1.0 - pow(1.0 - c, n));
+}
+
+void al_sfxr_compile_ex(al_sfxr_Patch* const patch, al_sfxr_Params const* const params,
+                        unsigned const sample_rate, unsigned const oversampling) {
+    patch->wave_type = params->wave_type;
+    patch->lpf_on = params->p_lpf_freq != 1.0f;
+    patch->freq_limit = params->p_freq_limit > 0.0f;
+
+    patch->fperiod = 100.0 / (params->p_base_freq * params->p_base_freq + 0.001);
+    patch->period = (int)patch->fperiod;
+    patch->fmaxperiod = 100.0 / (params->p_freq_limit * params->p_freq_limit + 0.001);
+    patch->fslide = 1.0 - pow((double)params->p_freq_ramp, 3.0) * 0.01;
+    patch->fdslide = -pow((double)params->p_freq_dramp, 3.0) * 0.000001;
+    patch->square_duty = 0.5f - params->p_duty * 0.5f;
+    patch->square_slide = -params->p_duty_ramp * 0.00005f;
+
+    if (params->p_arp_mod >= 0.0f) {
+        patch->arp_mod = 1.0 - pow((double)params->p_arp_mod, 2.0) * 0.9;
+    }
+    else {
+        patch->arp_mod = 1.0 + pow((double)params->p_arp_mod, 2.0) * 10.0;
+    }
+
+    patch->arp_limit = (int)(pow(1.0f - params->p_arp_speed, 2.0f) * 20000 + 32);
+
+    if (params->p_arp_speed == 1.0f) {
+        patch->arp_limit = 0;
+    }
+
+    /* Filter */
+    patch->fltw = pow(params->p_lpf_freq, 3.0f) * 0.1f;
+    patch->fltw_d = 1.0f + params->p_lpf_ramp * 0.0001f;
+    patch->fltdmp = 5.0f / (1.0f + pow(params->p_lpf_resonance, 2.0f) * 20.0f) * (0.01f + patch->fltw);
+
+    if (patch->fltdmp > 0.8f) {
+        patch->fltdmp = 0.8f;
+    }
+
+    patch->flthp = pow(params->p_hpf_freq, 2.0f) * 0.1f;
+    patch->flthp_d = 1.0 + params->p_hpf_ramp * 0.0003f;
+
+    /* Vibrato */
+    patch->vib_speed = pow(params->p_vib_speed, 2.0f) * 0.01f;
+    patch->vib_amp = params->p_vib_strength * 0.5f;
+
+    /* Envelope */
+    patch->env_length[0] = (int)(params->p_env_attack * params->p_env_attack * 100000.0f);
+    patch->env_length[1] = (int)(params->p_env_sustain * params->p_env_sustain * 100000.0f);
+    patch->env_length[2] = (int)(params->p_env_decay * params->p_env_decay * 100000.0f);
+    patch->env_punch = params->p_env_punch;
+
+    /* Phaser */
+    patch->fphase = pow(params->p_pha_offset, 2.0f) * 1020.0f;
+
+    if (params->p_pha_offset < 0.0f) {
+        patch->fphase = -patch->fphase;
+    }
+
+    patch->fdphase = pow(params->p_pha_ramp, 2.0f) * 1.0f;
+
+    if (params->p_pha_ramp < 0.0f) {
+        patch->fdphase = -patch->fdphase;
+    }
+
+    patch->iphase = abs((int)patch->fphase);
+
+    /* Without an offset or a sweep the phaser reads back the sample that was
+       just written, and doesn't need a delay line */
+    patch->phaser_on = patch->fphase != 0.0f || patch->fdphase != 0.0f;
+
+    /* Repeat */
+    patch->rep_limit = (int)(pow(1.0f - params->p_repeat_speed, 2.0f) * 20000 + 32);
+
+    if (params->p_repeat_speed == 0.0f) {
+        patch->rep_limit = 0;
+    }
+
+    patch->volume = 2.0f * params->sound_vol;
+    patch->oversampling = 8;
+    patch->min_period = 8;
+    patch->fltw_max = 0.1f;
+    patch->flthp_min = 0.00001f;
+    patch->flthp_max = 0.1f;
+
+    if (oversampling == 1 || oversampling == 2 || oversampling == 4) {
+        /* Everything that counts or steps sub-samples is rescaled like for a
+           lower sample rate. The factors are powers of two, so periods and
+           the frequency limit are scaled exactly. */
+        double const s = 8.0 / oversampling;
+
+        patch->oversampling = (int)oversampling;
+        patch->min_period = (int)oversampling;
+        patch->fperiod /= s;
+        patch->period = (int)patch->fperiod;
+        patch->fmaxperiod /= s;
+        patch->fltw *= s;
+        patch->fltw_d = pow(patch->fltw_d, s);
+        patch->fltw_max *= s;
+        patch->fltdmp *= s;
+
+        if (patch->fltdmp > 0.8f) {
+            patch->fltdmp = 0.8f;
+        }
+
+        patch->flthp = al_sfxr_onepole(patch->flthp, s);
+        patch->flthp_min = al_sfxr_onepole(patch->flthp_min, s);
+        patch->flthp_max = al_sfxr_onepole(patch->flthp_max, s);
+        patch->fphase /= s;
+        patch->fdphase /= s;
+        patch->iphase = abs((int)patch->fphase);
+    }
+
+    unsigned const rate = sample_rate < AL_SFXR_MIN_RATE ? AL_SFXR_MIN_RATE :
+                          sample_rate > AL_SFXR_MAX_RATE ? AL_SFXR_MAX_RATE : sample_rate;
+
+    if (rate == 44100) {
+        return;
+    }
+
+    /* k is the length of a frame in 44100 Hz frames. Durations in frames and
+       sub-samples are divided by it, and per-frame or per-sub-sample steps
+       are multiplied by it, or raised to it when they're multiplicative. The
+       frequency slide acceleration is applied to a step, so it's scaled
+       twice. The phaser sweep moves an offset in sub-samples once per frame,
+       so the two scales cancel out. */
+    double const k = 44100.0 / rate;
+
+    patch->fperiod /= k;
+    patch->period = (int)patch->fperiod;
+    patch->fmaxperiod /= k;
+    patch->fslide = pow(patch->fslide, k);
+    patch->fdslide *= k * k;
+    patch->square_slide *= k;
+
+    if (patch->arp_limit != 0) {
+        patch->arp_limit = (int)(patch->arp_limit / k);
+    }
+
+    patch->fltw *= k;
+    patch->fltw_d = pow(patch->fltw_d, k);
+    patch->fltw_max *= k;
+
+    /* The low-pass filter diverges when its coefficient goes above 4, as it
+       can at low rates with low oversampling factors, so it's limited to 2,
+       well inside the stable range for any damping */
+    if (patch->fltw_max > 2.0f) {
+        patch->fltw_max = 2.0f;
+    }
+
+    if (patch->fltw > patch->fltw_max) {
+        patch->fltw = patch->fltw_max;
+    }
+    patch->fltdmp *= k;
+
+    if (patch->fltdmp > 0.8f) {
+        patch->fltdmp = 0.8f;
+    }
+
+    patch->flthp = al_sfxr_onepole(patch->flthp, k);
+    patch->flthp_min = al_sfxr_onepole(patch->flthp_min, k);
+    patch->flthp_max = al_sfxr_onepole(patch->flthp_max, k);
+    patch->flthp_d = pow(patch->flthp_d, k);
+
+    patch->vib_speed *= k;
+
+    /* The envelope divides by the length of its stages, so stages with
+       frames at 44100 Hz keep at least one */
+    for (int i = 0; i < 3; i++) {
+        if (patch->env_length[i] != 0) {
+            int const length = (int)(patch->env_length[i] / k);
+            patch->env_length[i] = length > 0 ? length : 1;
+        }
+    }
+
+    patch->fphase /= k;
+    patch->iphase = abs((int)patch->fphase);
+
+    if (patch->rep_limit != 0) {
+        patch->rep_limit = (int)(patch->rep_limit / k);
+    }
+}
+
+static size_t al_sfxr_patchlength(al_sfxr_Patch const* const patch) {
+    int const* const env_length = patch->env_length;
+
+    /* Every stage lasts its length plus one frame, except the attack */
+    size_t const env_frames = (size_t)env_length[0] + (size_t)env_length[1] + 1 + (size_t)env_length[2] + 1;
+
+    if (!patch->freq_limit) {
+        return env_frames;
+    }
+
+    /* The frequency limit can end the sound earlier, so run the repeat,
+       arpeggio, envelope, and frequency slide like al_sfxr_events and
+       al_sfxr_step do, with the same floating point operations */
+    double fperiod = patch->fperiod;
+    double fslide = patch->fslide;
+    int rep_time = 0, arp_time = 0, arp_limit = patch->arp_limit;
+    int env_stage = 0, env_time = 0;
+    size_t frames = 0;
+
+    for (;;) {
+        if (patch->rep_limit != 0 && rep_time + 1 >= patch->rep_limit) {
+            rep_time = -1;
+            fperiod = patch->fperiod;
+            fslide = patch->fslide;
+            arp_time = 0;
+            arp_limit = patch->arp_limit;
+        }
+
+        if (arp_limit != 0 && arp_time + 1 >= arp_limit) {
+            arp_limit = 0;
+            fperiod *= patch->arp_mod;
+        }
+
+        if (env_time + 1 > env_length[env_stage]) {
+            env_time = -1;
+
+            if (++env_stage == 3) {
+                return frames;
+            }
+        }
+
+        fslide += patch->fdslide;
+        fperiod *= fslide;
+
+        if (fperiod > patch->fmaxperiod) {
+            return frames;
+        }
+
+        rep_time++;
+        arp_time++;
+        env_time++;
+        frames++;
+    }
+}
+
+size_t al_sfxr_length(al_sfxr_Params const* const params) {
+    return al_sfxr_length_rate(params, 44100);
+}
+
+size_t al_sfxr_length_rate(al_sfxr_Params const* const params, unsigned const sample_rate) {
+    al_sfxr_Patch patch;
+    al_sfxr_compile_rate(&patch, params, sample_rate);
+    return al_sfxr_patchlength(&patch);
+}
+
+float al_sfxr_peak(al_sfxr_Params const* const params) {
+    al_sfxr_Patch patch;
+    al_sfxr_compile(&patch, params);
+
+    if (patch.lpf_on) {
+        return 1.0f;
+    }
+
+    /* Without the low-pass filter, the high-pass filter sees the wave itself,
+       and a jump across the whole wave can make its output reach twice the
+       wave amplitude. The phaser adds two of these outputs. */
+    double const amplitude = patch.wave_type == AL_SFXR_SQUARE ? 0.5 : 1.0;
+    double const env_max = fmax(1.0, fabs(1.0 + 2.0 * patch.env_punch));
+    double const peak = amplitude * 2.0 * 2.0 * env_max * fabs(patch.volume);
+
+    return peak < 1.0 ? (float)peak : 1.0f;
+}
+
+static void al_sfxr_resetsample(al_sfxr_Voice* const voice, int const restart) {
+    al_sfxr_Patch const* const patch = voice->patch;
+
+    if (!restart) {
+        voice->phase = 0;
+    }
+
+    voice->fperiod = patch->fperiod;
+    voice->period = patch->period;
+    voice->fslide = patch->fslide;
+    voice->square_duty = patch->square_duty;
+    voice->arp_time = 0;
+    voice->arp_limit = patch->arp_limit;
+
+    if (!restart) {
+        /* Reset filter */
+        voice->fltp = 0.0f;
+        voice->fltdp = 0.0f;
+        voice->fltw = patch->fltw;
+        voice->fltphp = 0.0f;
+        voice->flthp = patch->flthp;
+        voice->decimation = 0.0f;
+
+        /* Reset vibrato */
+        voice->vib_phase = 0.0f;
+
+        /* Reset envelope */
+        voice->env_vol = 0.0f;
+        voice->env_stage = 0;
+        voice->env_time = 0;
+
+        voice->fphase = patch->fphase;
+        voice->iphase = patch->iphase;
+        voice->ipp = 0;
+
+        if (voice->phaser_buffer != NULL) {
+            memset((void*)voice->phaser_buffer, 0, AL_SFXR_PHASER_SIZE * sizeof(float));
+        }
+
+        /* Only noise reads the PRNG, so other waves don't need the buffer */
+        if (patch->wave_type == AL_SFXR_NOISE) {
+            for(int i = 0; i < 32; i++) {
+                voice->noise_buffer[i] = al_sfxr_randf(&voice->prng, 2.0f) - 1.0f;
+            }
+        }
+
+        voice->rep_time = 0;
+    }
+}
+
+/* Approximates sin(turns * 2 * pi) for turns >= -0.5 with an odd minimax
+   polynomial on [-0.25, 0.25], with a maximum absolute error of 8e-7, well
+   below the resolution of 16-bit samples */
+static AL_SFXR_INLINE float al_sfxr_fastsin(float const turns) {
+    float x = turns - (float)(int)(turns + 0.5f);
+
+    if (x > 0.25f) {
+        x = 0.5f - x;
+    }
+    else if (x < -0.25f) {
+        x = -0.5f - x;
+    }
+
+    float const x2 = x * x;
+    return x * (6.28316404f + x2 * (-41.3371424f + x2 * (81.3407689f + x2 * -70.9934333f)));
+}
+
+/* Handles the repeat, arpeggio, and envelope events that happen at the start
+   of the next frame. Returns 0 if the sound ended. */
+static int al_sfxr_events(al_sfxr_Voice* const voice) {
+    al_sfxr_Patch const* const patch = voice->patch;
+
+    if (patch->rep_limit != 0 && voice->rep_time + 1 >= patch->rep_limit) {
+        voice->rep_time = -1;
+        al_sfxr_resetsample(voice, 1);
+        AL_SFXR_COUNT(voice, repeats);
+    }
+
+    if (voice->arp_limit != 0 && voice->arp_time + 1 >= voice->arp_limit) {
+        voice->arp_limit = 0;
+        voice->fperiod *= patch->arp_mod;
+    }
+
+    if (voice->env_time + 1 > patch->env_length[voice->env_stage]) {
+        voice->env_time = -1;
+        voice->env_stage++;
+
+        if (voice->env_stage == 3) {
+            voice->playing_sample = 0;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Returns the number of frames, starting at the next one, that can be
+   rendered before another event must be handled. Must be called after
+   al_sfxr_events, so the result is at least 1. */
+static size_t al_sfxr_span(al_sfxr_Voice const* const voice, size_t span) {
+    al_sfxr_Patch const* const patch = voice->patch;
+
+    if (patch->rep_limit != 0 && (size_t)(patch->rep_limit - voice->rep_time - 1) < span) {
+        span = (size_t)(patch->rep_limit - voice->rep_time - 1);
+    }
+
+    if (voice->arp_limit != 0 && (size_t)(voice->arp_limit - voice->arp_time - 1) < span) {
+        span = (size_t)(voice->arp_limit - voice->arp_time - 1);
+    }
+
+    if ((size_t)(patch->env_length[voice->env_stage] - voice->env_time) < span) {
+        span = (size_t)(patch->env_length[voice->env_stage] - voice->env_time);
+    }
+
+    return span;
+}
+
+/* Advances the frame-rate state of the voice for the next frame: frequency
+   slide and vibrato, square duty, volume envelope, phaser offset, and
+   high-pass cutoff. Returns 0 if the frequency limit ended the sound. */
+static AL_SFXR_INLINE int al_sfxr_step(al_sfxr_Voice* const voice, int const vib_on, int const blep) {
+    al_sfxr_Patch const* const patch = voice->patch;
+
+    voice->fslide += patch->fdslide;
+    voice->fperiod *= voice->fslide;
+
+    if (voice->fperiod > patch->fmaxperiod) {
+        voice->fperiod = patch->fmaxperiod;
+
+        if (patch->freq_limit) {
+            voice->playing_sample = 0;
+            AL_SFXR_COUNT(voice, frequency_limits);
+            return 0;
+        }
+    }
+
+    float rfperiod = voice->fperiod;
+
+    if (vib_on) {
+        voice->vib_phase += patch->vib_speed;
+
+        if (voice->mode & AL_SFXR_MODE_FAST_TRIG) {
+            rfperiod = voice->fperiod * (1.0 + al_sfxr_fastsin(voice->vib_phase * 0.159154943f) * patch->vib_amp);
+        }
+        else {
+            rfperiod = voice->fperiod * (1.0 + sin(voice->vib_phase) * patch->vib_amp);
+        }
+    }
+
+    /* Band-limited waves keep the fraction of the period */
+    int const steps = blep ? AL_SFXR_BLEP_STEPS : 1;
+    voice->period = (int)(rfperiod * steps);
+
+    if (voice->period < patch->min_period * steps) {
+        voice->period = patch->min_period * steps;
+    }
+
+    voice->square_duty += patch->square_slide;
+
+    if (voice->square_duty < 0.0f) {
+        voice->square_duty = 0.0f;
+    }
+
+    if (voice->square_duty > 0.5f) {
+        voice->square_duty = 0.5f;
+    }
+
+    /* Volume envelope */
+    voice->env_time++;
+
+    if (voice->env_stage == 0) {
+        voice->env_vol = (float)voice->env_time / patch->env_length[0];
+    }
+    else if (voice->env_stage == 1) {
+        voice->env_vol = 1.0f + pow(1.0f - (float)voice->env_time / patch->env_length[1], 1.0f) *
+                           2.0f * patch->env_punch;
+    }
+    else {
+        voice->env_vol = 1.0f - (float)voice->env_time / patch->env_length[2];
+    }
+
+    /* Phaser step */
+    voice->fphase += patch->fdphase;
+    voice->iphase = abs((int)voice->fphase);
+
+    if (voice->iphase > 1023) {
+        voice->iphase = 1023;
+    }
+
+    if (patch->flthp_d != 0.0f) {
+        voice->flthp *= patch->flthp_d;
+
+        if (voice->flthp < patch->flthp_min) {
+            voice->flthp = patch->flthp_min;
+        }
+
+        if (voice->flthp > patch->flthp_max) {
+            voice->flthp = patch->flthp_max;
+        }
+    }
+
+    return 1;
 }
 
-static uint32_t al_sfxr_randu(al_sfxr_Prng* const prng, uint32_t const max_m1) {
-    if (max_m1 == UINT32_MAX) {
-        prng->seed = UINT64_C(6364136223846793005) * prng->seed + 1;
-        return (uint32_t)(prng->seed >> 32);
+/* Refills the noise buffer in AL_SFXR_MODE_FAST_NOISE. Entry j hashes a PRNG
+   output plus j times the golden ratio with a xorshift and a 32x32-bit
+   multiplication, folding the high half of the product into the low one.
+   SSE2 and AVX2 only multiply half of the lanes at a time, into 64 bits,
+   which is what the fold needs. The top 23 bits of the hash are the mantissa
+   of a float in [2, 4) that is then moved to [-1, 1). */
+#define AL_SFXR_NOISE_GOLDEN UINT32_C(0x9e3779b9)
+#define AL_SFXR_NOISE_MUL UINT32_C(0x846ca68b)
+
+#if !defined(AL_SFXR_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+
+static void al_sfxr_fastnoise(al_sfxr_Voice* const voice) {
+    uint32_t const key = al_sfxr_randu(&voice->prng, UINT32_MAX);
+
+    __m256i x = _mm256_add_epi32(
+        _mm256_set1_epi32((int)key),
+        _mm256_mullo_epi32(_mm256_set1_epi32((int)AL_SFXR_NOISE_GOLDEN), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))
+    );
+
+    __m256i const step = _mm256_set1_epi32((int)(AL_SFXR_NOISE_GOLDEN * 8));
+    __m256i const mul = _mm256_set1_epi32((int)AL_SFXR_NOISE_MUL);
+    __m256i const high = _mm256_set1_epi64x((long long)UINT64_C(0xffffffff00000000));
+    __m256i const two = _mm256_set1_epi32(0x40000000);
+    __m256 const three = _mm256_set1_ps(3.0f);
+
+    for (int j = 0; j < 32; j += 8) {
+        __m256i const h = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+        __m256i const even = _mm256_mul_epu32(h, mul);
+        __m256i const odd = _mm256_mul_epu32(_mm256_srli_epi64(h, 32), mul);
+        __m256i const hash = _mm256_or_si256(
+            _mm256_andnot_si256(high, _mm256_xor_si256(even, _mm256_srli_epi64(even, 32))),
+            _mm256_and_si256(high, _mm256_xor_si256(odd, _mm256_slli_epi64(odd, 32)))
+        );
+
+        __m256i const bits = _mm256_or_si256(_mm256_srli_epi32(hash, 9), two);
+        _mm256_storeu_ps(voice->noise_buffer + j, _mm256_sub_ps(_mm256_castsi256_ps(bits), three));
+        x = _mm256_add_epi32(x, step);
+    }
+}
+#elif !defined(AL_SFXR_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+
+static void al_sfxr_fastnoise(al_sfxr_Voice* const voice) {
+    uint32_t const key = al_sfxr_randu(&voice->prng, UINT32_MAX);
+    uint32_t const golden = AL_SFXR_NOISE_GOLDEN;
+
+    __m128i x = _mm_setr_epi32((int)key, (int)(key + golden), (int)(key + golden * 2), (int)(key + golden * 3));
+    __m128i const step = _mm_set1_epi32((int)(golden * 4));
+    __m128i const mul = _mm_set1_epi32((int)AL_SFXR_NOISE_MUL);
+    __m128i const high = _mm_setr_epi32(0, -1, 0, -1);
+    __m128i const two = _mm_set1_epi32(0x40000000);
+    __m128 const three = _mm_set1_ps(3.0f);
+
+    for (int j = 0; j < 32; j += 4) {
+        __m128i const h = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        __m128i const even = _mm_mul_epu32(h, mul);
+        __m128i const odd = _mm_mul_epu32(_mm_srli_epi64(h, 32), mul);
+        __m128i const hash = _mm_or_si128(
+            _mm_andnot_si128(high, _mm_xor_si128(even, _mm_srli_epi64(even, 32))),
+            _mm_and_si128(high, _mm_xor_si128(odd, _mm_slli_epi64(odd, 32)))
+        );
+
+        __m128i const bits = _mm_or_si128(_mm_srli_epi32(hash, 9), two);
+        _mm_storeu_ps(voice->noise_buffer + j, _mm_sub_ps(_mm_castsi128_ps(bits), three));
+        x = _mm_add_epi32(x, step);
     }
+}
+#else
+static void al_sfxr_fastnoise(al_sfxr_Voice* const voice) {
+    uint32_t const key = al_sfxr_randu(&voice->prng, UINT32_MAX);
 
-    uint32_t const max = max_m1 + 1;
-    uint64_t const num_fits = ((uint64_t)UINT32_MAX + 1) / max;
-    uint64_t const max_rn = num_fits * max;
+    for (int j = 0; j < 32; j++) {
+        uint32_t x = key + AL_SFXR_NOISE_GOLDEN * (uint32_t)j;
+        x ^= x >> 16;
 
-    while (1) {
-        prng->seed = UINT64_C(6364136223846793005) * prng->seed + 1;
-        uint32_t const rn = (uint32_t)(prng->seed >> 32);
+        uint64_t const product = (uint64_t)x * AL_SFXR_NOISE_MUL;
+        uint32_t const hash = (uint32_t)product ^ (uint32_t)(product >> 32);
+        uint32_t const bits = (hash >> 9) | UINT32_C(0x40000000);
 
-        if (rn < max_rn) {
-            return rn % max;
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        voice->noise_buffer[j] = value - 3.0f;
+    }
+}
+#endif
+
+/* PolyBLEP residual for a jump of 2 at phase 0 of a wave, t is the phase in
+   [0, 1) and dt the phase increment of a sub-sample */
+static AL_SFXR_INLINE float al_sfxr_polyblep(float t, float const dt) {
+    if (t < dt) {
+        t /= dt;
+        return t + t - t * t - 1.0f;
+    }
+    else if (t > 1.0f - dt) {
+        t = (t - 1.0f) / dt;
+        return t * t + t + t + 1.0f;
+    }
+
+    return 0.0f;
+}
+
+/* Where and how a kernel writes its frames. Frames are clamped to [-limit,
+   limit], and then either stored, or multiplied by the gains and added to
+   one or two channels. */
+typedef struct {
+    float left;
+    float right;
+    float limit;
+    int channels;
+    int add;
+}
+al_sfxr_Output;
+
+/* Stores mono frames clamped to [-1, 1] */
+static al_sfxr_Output const al_sfxr_store = {1.0f, 1.0f, 1.0f, 1, 0};
+
+/* Renders up to num_frames frames that are free of events, except for the
+   frequency limit that can end the sound. Returns the number of frames
+   rendered. The wave type, the low-pass filter and vibrato switches, the
+   fast sine and band-limited switches, and the oversampling factor are
+   arguments so that each kernel gets a copy of this function specialized for
+   constant values. */
+static AL_SFXR_INLINE size_t al_sfxr_render(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames,
+                                            al_sfxr_Output const* const output, al_sfxr_Wave const wave_type, int const lpf_on, int const vib_on,
+                                            int const fast_sin, int const bandlimited, int const oversampling) {
+    al_sfxr_Patch const* const patch = voice->patch;
+    int const blep = bandlimited && (wave_type == AL_SFXR_SQUARE || wave_type == AL_SFXR_SAWTOOTH);
+    int const steps = blep ? AL_SFXR_BLEP_STEPS : 1;
+    float const fltw_d = patch->fltw_d;
+    float const fltw_max = patch->fltw_max;
+    float const fltdmp = patch->fltdmp;
+    float const volume = patch->volume;
+    float* const phaser_buffer = voice->phaser_buffer;
+    float const left = output->left;
+    float const right = output->right;
+    float const limit = output->limit;
+    int const channels = output->channels;
+    int const add = output->add;
+
+    int phase = voice->phase;
+    float fltp = voice->fltp;
+    float fltdp = voice->fltdp;
+    float fltw = voice->fltw;
+    float fltphp = voice->fltphp;
+    float decimation = voice->decimation;
+    int ipp = voice->ipp;
+
+    /* Weight that makes the triangle decimation filter sum to one */
+    float const weight = 1.0f / (float)(oversampling * oversampling);
+
+#if defined(AL_SFXR_PROFILE)
+    uint64_t cycles[AL_SFXR_STAGE_COUNT] = {0};
+    uint64_t last = 0;
+    uint64_t sampled_frames = 0;
+#endif
+
+    size_t i = 0;
+
+    for (; i < num_frames; i++) {
+#if defined(AL_SFXR_PROFILE)
+        int const sampled = (voice->profile.frames + i) % AL_SFXR_PROFILE_PERIOD == 0;
+
+        if (sampled) {
+            last = al_sfxr_cycles();
+        }
+#endif
+
+        if (!al_sfxr_step(voice, vib_on, blep)) {
+            break;
+        }
+
+        AL_SFXR_STAGE(AL_SFXR_STAGE_FRAME);
+
+        int const period = voice->period;
+        float const dt = (float)steps / period;
+        float const square_duty = voice->square_duty;
+        float const env_vol = voice->env_vol;
+        int const iphase = voice->iphase;
+        float const flthp = voice->flthp;
+
+        float ssample = 0.0f;
+        float snext = 0.0f;
+
+        for (int si = 0; si < oversampling; si++) {
+            float sample = 0.0f;
+
+            phase += steps;
+
+            if (phase >= period) {
+                phase %= period;
+
+                if (wave_type == AL_SFXR_NOISE) {
+                    AL_SFXR_COUNT(voice, noise_refills);
+
+                    if (voice->mode & AL_SFXR_MODE_FAST_NOISE) {
+                        al_sfxr_fastnoise(voice);
+                    }
+                    else {
+                        for (int j = 0; j < 32; j++) {
+                            voice->noise_buffer[j] = al_sfxr_randf(&voice->prng, 2.0f) - 1.0f;
+                        }
+                    }
+                }
+            }
+
+            /* Base waveform */
+            float fp = (float)phase / period;
+
+            switch (wave_type) {
+                case AL_SFXR_SQUARE:
+                    if (fp < square_duty) {
+                        sample = 0.5f;
+                    }
+                    else {
+                        sample = -0.5f;
+                    }
+
+                    if (blep) {
+                        /* Rises by 1 at phase 0 and falls by 1 at the duty */
+                        float const fall = fp < square_duty ? fp - square_duty + 1.0f : fp - square_duty;
+                        sample += 0.5f * (al_sfxr_polyblep(fp, dt) - al_sfxr_polyblep(fall, dt));
+                    }
+
+                    break;
+
+                case AL_SFXR_SAWTOOTH:
+                    sample = 1.0f - fp * 2.0f;
+
+                    if (blep) {
+                        sample += al_sfxr_polyblep(fp, dt);
+                    }
+
+                    break;
+
+                case AL_SFXR_SINEWAVE:
+                    if (fast_sin) {
+                        sample = al_sfxr_fastsin(fp);
+                    }
+                    else {
+                        sample = (float)sin(fp * 2.0f * 3.14159265358979323846f);
+                    }
+
+                    break;
+
+                case AL_SFXR_NOISE:
+                    sample = voice->noise_buffer[phase * 32 / period];
+                    break;
+            }
+
+            AL_SFXR_STAGE(AL_SFXR_STAGE_OSCILLATOR);
+
+            /* Low-pass filter, the cutoff sweep doesn't matter if it's off */
+            float pp = fltp;
+
+            if (lpf_on) {
+                fltw *= fltw_d;
+
+                if (fltw < 0.0f) {
+                    fltw = 0.0f;
+                }
+
+                if (fltw > fltw_max) {
+                    fltw = fltw_max;
+                }
+
+                fltdp += (sample - fltp) * fltw;
+                fltdp -= fltdp * fltdmp;
+                fltp += fltdp;
+            }
+            else {
+                fltp = sample;
+                fltdp = 0.0f;
+            }
+
+            AL_SFXR_STAGE(AL_SFXR_STAGE_LPF);
+
+            /* High-pass filter */
+            fltphp += fltp - pp;
+            fltphp -= fltphp * flthp;
+            sample = fltphp;
+
+            AL_SFXR_STAGE(AL_SFXR_STAGE_HPF);
+
+            /* Phaser */
+            if (phaser_buffer != NULL) {
+                phaser_buffer[ipp & 1023] = sample;
+                sample += phaser_buffer[(ipp - iphase + 1024) & 1023];
+                ipp = (ipp + 1) & 1023;
+            }
+            else {
+                /* Same as reading back the sample that was just written */
+                sample += sample;
+            }
+
+            AL_SFXR_STAGE(AL_SFXR_STAGE_PHASER);
+
+            /* Final accumulation and envelope application. The triangle
+               filter of a frame rises over the sub-samples of the previous
+               frame and falls over its own ones, so each sub-sample also
+               goes into the next frame. */
+            if (oversampling == 8) {
+                ssample += sample * env_vol;
+            }
+            else {
+                sample *= env_vol;
+                ssample += sample * ((float)(oversampling - si) - 0.5f);
+                snext += sample * ((float)si + 0.5f);
+            }
+
+            AL_SFXR_STAGE(AL_SFXR_STAGE_OUTPUT);
+        }
+
+        if (oversampling == 8) {
+            ssample = ssample / 8;
+        }
+        else {
+            ssample = (ssample + decimation) * weight;
+            decimation = snext;
+        }
+
+        ssample *= volume;
+
+        if (ssample > limit) {
+            ssample = limit;
+        }
+        else if (ssample < -limit) {
+            ssample = -limit;
+        }
+
+        if (channels == 2) {
+            frames[i * 2] += ssample * left;
+            frames[i * 2 + 1] += ssample * right;
         }
+        else if (add) {
+            frames[i] += ssample * left;
+        }
+        else {
+            frames[i] = ssample;
+        }
+
+        AL_SFXR_STAGE(AL_SFXR_STAGE_OUTPUT);
+
+#if defined(AL_SFXR_PROFILE)
+        sampled_frames += sampled;
+#endif
+    }
+
+#if defined(AL_SFXR_PROFILE)
+    voice->profile.frames += i;
+    voice->profile.sampled_frames += sampled_frames;
+
+    for (int stage = 0; stage < AL_SFXR_STAGE_COUNT; stage++) {
+        voice->profile.cycles[stage] += cycles[stage];
     }
+#endif
+
+    voice->phase = phase;
+    voice->fltp = fltp;
+    voice->fltdp = fltdp;
+    voice->fltw = fltw;
+    voice->fltphp = fltphp;
+    voice->decimation = decimation;
+    voice->ipp = ipp;
+
+    voice->rep_time += (int)i;
+    voice->arp_time += (int)i;
+    return i;
 }
 
-static float al_sfxr_randf(al_sfxr_Prng* const prng, float const max) {
-    return (float)(al_sfxr_randu(prng, UINT32_MAX)) * max / (float)UINT32_MAX;
+static size_t al_sfxr_render_generic(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames,
+                                     al_sfxr_Output const* const output) {
+    return al_sfxr_render(
+        voice, frames, num_frames, output,
+        voice->patch->wave_type, voice->patch->lpf_on, voice->patch->vib_amp > 0.0f,
+        (voice->mode & AL_SFXR_MODE_FAST_TRIG) != 0, (voice->mode & AL_SFXR_MODE_BANDLIMITED) != 0,
+        voice->patch->oversampling
+    );
 }
 
-#if defined(AL_SFXR_LOAD) || defined(AL_SFXR_GENERATE)
-static void al_sfxr_zero(al_sfxr_Params* const params) {
-    params->wave_type = AL_SFXR_SQUARE;
+/* Kernels are specialized for 8x oversampling, lower factors share a copy
+   that loops over a variable number of sub-samples */
+#define AL_SFXR_KERNEL(name, wave_type, lpf_on, vib_on, fast_sin, blep) \
+    static size_t name(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames, \
+                       al_sfxr_Output const* const output) { \
+        if (voice->patch->oversampling == 8) { \
+            return al_sfxr_render(voice, frames, num_frames, output, wave_type, lpf_on, vib_on, fast_sin, blep, 8); \
+        } \
+        return al_sfxr_render(voice, frames, num_frames, output, wave_type, lpf_on, vib_on, fast_sin, blep, \
+                              voice->patch->oversampling); \
+    }
 
-    params->p_base_freq = 0.3f;
-    params->p_freq_limit = 0.0f;
-    params->p_freq_ramp = 0.0f;
-    params->p_freq_dramp = 0.0f;
-    params->p_duty = 0.0f;
-    params->p_duty_ramp = 0.0f;
+AL_SFXR_KERNEL(al_sfxr_render_square, AL_SFXR_SQUARE, 0, 0, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_square_vib, AL_SFXR_SQUARE, 0, 1, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_square_lpf, AL_SFXR_SQUARE, 1, 0, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_square_lpf_vib, AL_SFXR_SQUARE, 1, 1, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_sawtooth, AL_SFXR_SAWTOOTH, 0, 0, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_sawtooth_vib, AL_SFXR_SAWTOOTH, 0, 1, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_sawtooth_lpf, AL_SFXR_SAWTOOTH, 1, 0, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_sawtooth_lpf_vib, AL_SFXR_SAWTOOTH, 1, 1, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_sinewave, AL_SFXR_SINEWAVE, 0, 0, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_sinewave_vib, AL_SFXR_SINEWAVE, 0, 1, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_sinewave_lpf, AL_SFXR_SINEWAVE, 1, 0, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_sinewave_lpf_vib, AL_SFXR_SINEWAVE, 1, 1, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_noise, AL_SFXR_NOISE, 0, 0, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_noise_vib, AL_SFXR_NOISE, 0, 1, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_noise_lpf, AL_SFXR_NOISE, 1, 0, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_noise_lpf_vib, AL_SFXR_NOISE, 1, 1, 0, 0)
+AL_SFXR_KERNEL(al_sfxr_render_fastsin, AL_SFXR_SINEWAVE, 0, 0, 1, 0)
+AL_SFXR_KERNEL(al_sfxr_render_fastsin_vib, AL_SFXR_SINEWAVE, 0, 1, 1, 0)
+AL_SFXR_KERNEL(al_sfxr_render_fastsin_lpf, AL_SFXR_SINEWAVE, 1, 0, 1, 0)
+AL_SFXR_KERNEL(al_sfxr_render_fastsin_lpf_vib, AL_SFXR_SINEWAVE, 1, 1, 1, 0)
+AL_SFXR_KERNEL(al_sfxr_render_square_blep, AL_SFXR_SQUARE, 0, 0, 0, 1)
+AL_SFXR_KERNEL(al_sfxr_render_square_blep_vib, AL_SFXR_SQUARE, 0, 1, 0, 1)
+AL_SFXR_KERNEL(al_sfxr_render_square_blep_lpf, AL_SFXR_SQUARE, 1, 0, 0, 1)
+AL_SFXR_KERNEL(al_sfxr_render_square_blep_lpf_vib, AL_SFXR_SQUARE, 1, 1, 0, 1)
+AL_SFXR_KERNEL(al_sfxr_render_sawtooth_blep, AL_SFXR_SAWTOOTH, 0, 0, 0, 1)
+AL_SFXR_KERNEL(al_sfxr_render_sawtooth_blep_vib, AL_SFXR_SAWTOOTH, 0, 1, 0, 1)
+AL_SFXR_KERNEL(al_sfxr_render_sawtooth_blep_lpf, AL_SFXR_SAWTOOTH, 1, 0, 0, 1)
+AL_SFXR_KERNEL(al_sfxr_render_sawtooth_blep_lpf_vib, AL_SFXR_SAWTOOTH, 1, 1, 0, 1)
+
+#undef AL_SFXR_KERNEL
+
+/* Indexed by al_sfxr_Voice.kernel */
+static size_t (* const al_sfxr_kernels[])(al_sfxr_Voice* const, float* const, size_t const,
+                                           al_sfxr_Output const* const) = {
+    al_sfxr_render_generic,
+    al_sfxr_render_square, al_sfxr_render_square_vib, al_sfxr_render_square_lpf, al_sfxr_render_square_lpf_vib,
+    al_sfxr_render_sawtooth, al_sfxr_render_sawtooth_vib, al_sfxr_render_sawtooth_lpf, al_sfxr_render_sawtooth_lpf_vib,
+    al_sfxr_render_sinewave, al_sfxr_render_sinewave_vib, al_sfxr_render_sinewave_lpf, al_sfxr_render_sinewave_lpf_vib,
+    al_sfxr_render_noise, al_sfxr_render_noise_vib, al_sfxr_render_noise_lpf, al_sfxr_render_noise_lpf_vib,
+    al_sfxr_render_fastsin, al_sfxr_render_fastsin_vib, al_sfxr_render_fastsin_lpf, al_sfxr_render_fastsin_lpf_vib,
+    al_sfxr_render_square_blep, al_sfxr_render_square_blep_vib, al_sfxr_render_square_blep_lpf,
+    al_sfxr_render_square_blep_lpf_vib,
+    al_sfxr_render_sawtooth_blep, al_sfxr_render_sawtooth_blep_vib, al_sfxr_render_sawtooth_blep_lpf,
+    al_sfxr_render_sawtooth_blep_lpf_vib
+};
+
+static int al_sfxr_selectkernel(al_sfxr_Voice const* const voice) {
+    al_sfxr_Patch const* const patch = voice->patch;
+    unsigned const wave_type = (unsigned)patch->wave_type;
+
+    if (wave_type > AL_SFXR_NOISE) {
+        return 0;
+    }
 
-    params->p_vib_strength = 0.0f;
-    params->p_vib_speed = 0.0f;
+    int const lpf_on = patch->lpf_on;
+    int const vib_on = patch->vib_amp > 0.0f;
 
-    params->p_env_attack = 0.0f;
-    params->p_env_sustain = 0.3f;
-    params->p_env_decay = 0.4f;
-    params->p_env_punch = 0.0f;
+    if (wave_type == AL_SFXR_SINEWAVE && (voice->mode & AL_SFXR_MODE_FAST_TRIG) != 0) {
+        return 17 + lpf_on * 2 + vib_on;
+    }
 
-    params->p_lpf_resonance = 0.0f;
-    params->p_lpf_freq = 1.0f;
-    params->p_lpf_ramp = 0.0f;
-    params->p_hpf_freq = 0.0f;
-    params->p_hpf_ramp = 0.0f;
+    if (wave_type <= AL_SFXR_SAWTOOTH && (voice->mode & AL_SFXR_MODE_BANDLIMITED) != 0) {
+        return 21 + (int)wave_type * 4 + lpf_on * 2 + vib_on;
+    }
 
-    params->p_pha_offset = 0.0f;
-    params->p_pha_ramp = 0.0f;
+    return 1 + (int)wave_type * 4 + lpf_on * 2 + vib_on;
+}
 
-    params->p_repeat_speed = 0.0f;
+static void al_sfxr_startvoice(al_sfxr_Voice* const voice, al_sfxr_Patch const* const patch, uint64_t const seed,
+                               float* const phaser_buffer) {
+    voice->patch = patch;
+    voice->phaser_buffer = phaser_buffer;
+    al_sfxr_newprng(&voice->prng, seed);
+    al_sfxr_resetsample(voice, 0);
 
-    params->p_arp_speed = 0.0f;
-    params->p_arp_mod = 0.0f;
+    voice->mode = 0;
+    voice->kernel = al_sfxr_selectkernel(voice);
+    voice->playing_sample = 1;
 
-    params->sound_vol = 0.5f;
+#if defined(AL_SFXR_PROFILE)
+    memset((void*)&voice->profile, 0, sizeof(voice->profile));
+#endif
 }
-#endif /* defined(AL_SFXR_LOAD) || defined(AL_SFXR_GENERATE) */
 
-#if defined(AL_SFXR_LOAD)
-static int al_sfxr_read16(al_sfxr_Read8 const reader, void* const userdata, uint16_t* const word) {
-    uint8_t l = 0, h = 0;
+void al_sfxr_pool_init(al_sfxr_PhaserPool* const pool, al_sfxr_PhaserLine* const lines, size_t const count) {
+    pool->free = NULL;
+
+    for (size_t i = count; i > 0; i--) {
+        lines[i - 1].next = pool->free;
+        pool->free = lines + i - 1;
+    }
+}
+
+int al_sfxr_voice_start(al_sfxr_Voice* const voice, al_sfxr_Patch const* const patch, uint64_t const seed,
+                        al_sfxr_PhaserPool* const pool) {
+    al_sfxr_PhaserLine* line = NULL;
+
+    if (patch->phaser_on) {
+        if (pool == NULL || pool->free == NULL) {
+            voice->phaser_buffer = NULL;
+            voice->playing_sample = 0;
+            return -1;
+        }
+
+        line = pool->free;
+        pool->free = line->next;
+    }
+
+    al_sfxr_startvoice(voice, patch, seed, line != NULL ? line->samples : NULL);
+    return 0;
+}
+
+void al_sfxr_voice_stop(al_sfxr_Voice* const voice, al_sfxr_PhaserPool* const pool) {
+    if (voice->phaser_buffer != NULL) {
+        al_sfxr_PhaserLine* const line = (al_sfxr_PhaserLine*)(void*)voice->phaser_buffer;
+        line->next = pool->free;
+        pool->free = line;
+        voice->phaser_buffer = NULL;
+    }
+
+    voice->playing_sample = 0;
+}
+
+void al_sfxr_voice_restart(al_sfxr_Voice* const voice) {
+    al_sfxr_resetsample(voice, 0);
+}
+
+void al_sfxr_voice_set_mode(al_sfxr_Voice* const voice, unsigned const mode) {
+    al_sfxr_Wave const wave_type = voice->patch->wave_type;
+
+    /* Band-limited waves count the phase in smaller steps */
+    if (wave_type == AL_SFXR_SQUARE || wave_type == AL_SFXR_SAWTOOTH) {
+        unsigned const changed = (voice->mode ^ mode) & AL_SFXR_MODE_BANDLIMITED;
+
+        if (changed && (mode & AL_SFXR_MODE_BANDLIMITED) != 0) {
+            voice->phase *= AL_SFXR_BLEP_STEPS;
+            voice->period *= AL_SFXR_BLEP_STEPS;
+        }
+        else if (changed) {
+            voice->phase /= AL_SFXR_BLEP_STEPS;
+            voice->period /= AL_SFXR_BLEP_STEPS;
+        }
+    }
+
+    voice->mode = mode;
+    voice->kernel = al_sfxr_selectkernel(voice);
+}
+
+#if defined(AL_SFXR_PROFILE)
+void al_sfxr_voice_get_profile(al_sfxr_Voice const* const voice, al_sfxr_Profile* const profile) {
+    *profile = voice->profile;
+}
+#endif /* AL_SFXR_PROFILE */
+
+/* Sets the flags of AL_SFXR_MODE_FLUSH_DENORMALS and returns the previous
+   state of the FPU */
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+
+static uint64_t al_sfxr_flushdenormals(void) {
+    unsigned const csr = _mm_getcsr();
+
+    /* Flush-to-zero is bit 15 of MXCSR, and denormals-are-zero is bit 6 */
+    _mm_setcsr(csr | 0x8040u);
+    return csr;
+}
+
+static void al_sfxr_restorefpu(uint64_t const state) {
+    _mm_setcsr((unsigned)state);
+}
+#elif defined(__aarch64__) && defined(__GNUC__)
+static uint64_t al_sfxr_flushdenormals(void) {
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+
+    /* Flush-to-zero is bit 24 of FPCR, and also applies to the inputs */
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (UINT64_C(1) << 24)));
+    return fpcr;
+}
+
+static void al_sfxr_restorefpu(uint64_t const state) {
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(state));
+}
+#else
+static uint64_t al_sfxr_flushdenormals(void) {
+    return 0;
+}
+
+static void al_sfxr_restorefpu(uint64_t const state) {
+    (void)state;
+}
+#endif
+
+static size_t al_sfxr_voiceproduce(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames,
+                                   al_sfxr_Output const* const output) {
+    size_t (* const kernel)(al_sfxr_Voice* const, float* const, size_t const, al_sfxr_Output const* const) =
+        al_sfxr_kernels[voice->kernel];
+    size_t i = 0;
+
+    while (i < num_frames && voice->playing_sample) {
+        if (!al_sfxr_events(voice)) {
+            break;
+        }
+
+        size_t const span = al_sfxr_span(voice, num_frames - i);
+        size_t const rendered = kernel(voice, frames + i * (size_t)output->channels, span, output);
+        i += rendered;
+
+        if (rendered < span) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/* Renders with denormals flushed to zero when the mode asks for it */
+static size_t al_sfxr_voiceoutput(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames,
+                                  al_sfxr_Output const* const output) {
+    if ((voice->mode & AL_SFXR_MODE_FLUSH_DENORMALS) == 0) {
+        return al_sfxr_voiceproduce(voice, frames, num_frames, output);
+    }
+
+    uint64_t const fpu = al_sfxr_flushdenormals();
+    size_t const written = al_sfxr_voiceproduce(voice, frames, num_frames, output);
+    al_sfxr_restorefpu(fpu);
+    return written;
+}
+
+size_t al_sfxr_voice_produce(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames) {
+    return al_sfxr_voiceoutput(voice, frames, num_frames, &al_sfxr_store);
+}
+
+size_t al_sfxr_voice_mix1f(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames, float const gain,
+                           int const clamp) {
+    al_sfxr_Output const output = {gain, gain, clamp ? 1.0f : HUGE_VALF, 1, 1};
+    return al_sfxr_voiceoutput(voice, frames, num_frames, &output);
+}
+
+size_t al_sfxr_voice_mix2f(al_sfxr_Voice* const voice, float* const frames, size_t const num_frames, float const gain,
+                           float const pan, int const clamp) {
+    /* Constant power, both channels get -3 dB in the center */
+    float const p = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+    float const left = gain * sqrtf((1.0f - p) * 0.5f);
+    float const right = gain * sqrtf((1.0f + p) * 0.5f);
+
+    al_sfxr_Output const output = {left, right, clamp ? 1.0f : HUGE_VALF, 2, 1};
+    return al_sfxr_voiceoutput(voice, frames, num_frames, &output);
+}
+
+/* Returns the voice of a decoder pointing to the decoder's own patch and
+   delay line, which keeps decoders working after being copied */
+static al_sfxr_Voice* al_sfxr_ownvoice(al_sfxr_Decoder* const decoder) {
+    decoder->voice.patch = &decoder->patch;
+    decoder->voice.phaser_buffer = decoder->patch.phaser_on ? decoder->phaser_buffer : NULL;
+    return &decoder->voice;
+}
 
-    int ok = reader(userdata, &l);
-    ok = ok || reader(userdata, &h);
+void al_sfxr_start(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params, uint64_t const seed) {
+    al_sfxr_start_rate(decoder, params, seed, 44100);
+}
+
+void al_sfxr_start_rate(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params, uint64_t const seed,
+                        unsigned const sample_rate) {
+    al_sfxr_start_ex(decoder, params, seed, sample_rate, 8);
+}
+
+void al_sfxr_start_ex(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params, uint64_t const seed,
+                      unsigned const sample_rate, unsigned const oversampling) {
+    al_sfxr_compile_ex(&decoder->patch, params, sample_rate, oversampling);
+    al_sfxr_startvoice(&decoder->voice, &decoder->patch, seed, decoder->patch.phaser_on ? decoder->phaser_buffer : NULL);
+}
+
+void al_sfxr_start_quick(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params) {
+    al_sfxr_start(decoder, params, UINT64_C(0x89866ae81aa30a2b));
+}
+
+void al_sfxr_restart(al_sfxr_Decoder* const decoder) {
+    al_sfxr_voice_restart(al_sfxr_ownvoice(decoder));
+}
+
+void al_sfxr_set_mode(al_sfxr_Decoder* const decoder, unsigned const mode) {
+    al_sfxr_voice_set_mode(al_sfxr_ownvoice(decoder), mode);
+}
+
+#if defined(AL_SFXR_PROFILE)
+void al_sfxr_get_profile(al_sfxr_Decoder const* const decoder, al_sfxr_Profile* const profile) {
+    al_sfxr_voice_get_profile(&decoder->voice, profile);
+}
+#endif /* AL_SFXR_PROFILE */
+
+size_t al_sfxr_produce_block(al_sfxr_Decoder* const decoder, float* const frames, size_t const num_frames) {
+    return al_sfxr_voice_produce(al_sfxr_ownvoice(decoder), frames, num_frames);
+}
 
-    *word = (uint16_t)h << 8 | l;
-    return ok;
+#if defined(AL_SFXR_INT16_MONO) || defined(AL_SFXR_INT16_STEREO) || defined(AL_SFXR_FLOAT_STEREO)
+#define AL_SFXR_BLOCK_FRAMES 256
+
+#if !defined(AL_SFXR_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define AL_SFXR_CONVERT_SSE2
+#endif
+
+#if defined(AL_SFXR_INT16_MONO) || defined(AL_SFXR_INT16_STEREO)
+/* Scales a frame to 16 bits and saturates it, NaNs become 0. Truncates
+   towards zero like the vector version. */
+static AL_SFXR_INLINE int16_t al_sfxr_toint16(float const frame) {
+    float sample = frame * 32767.0f;
+    sample = sample == sample ? sample : 0.0f;
+    sample = sample > -32768.0f ? sample : -32768.0f;
+    sample = sample < 32767.0f ? sample : 32767.0f;
+    return (int16_t)sample;
 }
 
-static int al_sfxr_read32(al_sfxr_Read8 const reader, void* const userdata, uint32_t* const dword) {
-    uint16_t l = 0, h = 0;
+#if defined(AL_SFXR_CONVERT_SSE2)
+/* Converts 8 frames to 16 bits */
+static AL_SFXR_INLINE __m128i al_sfxr_toint16x8(float const* const source) {
+    __m128 const scale = _mm_set1_ps(32767.0f);
+    __m128 const min = _mm_set1_ps(-32768.0f);
+    __m128 const max = _mm_set1_ps(32767.0f);
+
+    __m128 lo = _mm_mul_ps(_mm_loadu_ps(source), scale);
+    __m128 hi = _mm_mul_ps(_mm_loadu_ps(source + 4), scale);
 
-    int ok = al_sfxr_read16(reader, userdata, &l);
-    ok = ok || al_sfxr_read16(reader, userdata, &h);
+    lo = _mm_min_ps(_mm_max_ps(_mm_and_ps(lo, _mm_cmpord_ps(lo, lo)), min), max);
+    hi = _mm_min_ps(_mm_max_ps(_mm_and_ps(hi, _mm_cmpord_ps(hi, hi)), min), max);
 
-    *dword = (uint32_t)h << 16 | l;
-    return ok;
+    return _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
 }
+#endif /* AL_SFXR_CONVERT_SSE2 */
+#endif /* AL_SFXR_INT16_MONO || AL_SFXR_INT16_STEREO */
+#endif /* AL_SFXR_INT16_MONO || AL_SFXR_INT16_STEREO || AL_SFXR_FLOAT_STEREO */
 
-static int al_sfxr_readf(al_sfxr_Read8 const reader, void* const userdata, float* const fp) {
-    uint32_t dword = 0;
+#if defined(AL_SFXR_INT16_MONO)
+void al_sfxr_convert1i(int16_t* const dest, float const* const source, size_t const num_frames) {
+    size_t i = 0;
 
-    int ok = al_sfxr_read32(reader, userdata, &dword);
+#if defined(AL_SFXR_CONVERT_SSE2)
+    for (; i + 8 <= num_frames; i += 8) {
+        _mm_storeu_si128((__m128i*)(dest + i), al_sfxr_toint16x8(source + i));
+    }
+#endif
 
-    memcpy((void*)fp, (void*)&dword, sizeof(*fp));
-    return ok;
+    for (; i < num_frames; i++) {
+        dest[i] = al_sfxr_toint16(source[i]);
+    }
 }
 
-static int al_sfxr_readi(al_sfxr_Read8 const reader, void* const userdata, int* const i) {
-    uint32_t temp = 0;
-    int ok = al_sfxr_read32(reader, userdata, &temp);
-    *i = (int)temp;
-    return ok;
+size_t al_sfxr_produce1i(al_sfxr_Decoder* const decoder, int16_t* frames, size_t const num_frames) {
+    size_t i = 0;
+
+    while (i < num_frames) {
+        float block[AL_SFXR_BLOCK_FRAMES];
+        size_t const count = num_frames - i < AL_SFXR_BLOCK_FRAMES ? num_frames - i : AL_SFXR_BLOCK_FRAMES;
+        size_t const produced = al_sfxr_produce_block(decoder, block, count);
+
+        al_sfxr_convert1i(frames + i, block, produced);
+        i += produced;
+
+        if (produced < count) {
+            break;
+        }
+    }
+
+    return i;
 }
+#endif /* AL_SFXR_INT16_MONO */
 
-int al_sfxr_load(al_sfxr_Params* const params, al_sfxr_Read8 const reader, void* const userdata) {
-    int version = 0;
-    int ok = al_sfxr_readi(reader, userdata, &version);
+#if defined(AL_SFXR_INT16_STEREO)
+void al_sfxr_convert2i(int16_t* const dest, float const* const source, size_t const num_frames) {
+    size_t i = 0;
 
-    if (version != 100 && version != 101 && version != 102) {
-        return -1;
+#if defined(AL_SFXR_CONVERT_SSE2)
+    for (; i + 8 <= num_frames; i += 8) {
+        __m128i const samples = al_sfxr_toint16x8(source + i);
+        _mm_storeu_si128((__m128i*)(dest + i * 2), _mm_unpacklo_epi16(samples, samples));
+        _mm_storeu_si128((__m128i*)(dest + i * 2 + 8), _mm_unpackhi_epi16(samples, samples));
     }
+#endif
 
-    al_sfxr_zero(params);
+    for (; i < num_frames; i++) {
+        int16_t const sample = al_sfxr_toint16(source[i]);
+        dest[i * 2] = sample;
+        dest[i * 2 + 1] = sample;
+    }
+}
 
-    int wave_type = AL_SFXR_SQUARE;
-    ok = ok || al_sfxr_readi(reader, userdata, &wave_type);
-    params->wave_type = (al_sfxr_Wave)wave_type;
+size_t al_sfxr_produce2i(al_sfxr_Decoder* const decoder, int16_t* frames, size_t const num_frames) {
+    size_t i = 0;
 
-    if (version == 102) {
-        ok = ok || al_sfxr_readf(reader, userdata, &params->sound_vol);
-    }
+    while (i < num_frames) {
+        float block[AL_SFXR_BLOCK_FRAMES];
+        size_t const count = num_frames - i < AL_SFXR_BLOCK_FRAMES ? num_frames - i : AL_SFXR_BLOCK_FRAMES;
+        size_t const produced = al_sfxr_produce_block(decoder, block, count);
 
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_base_freq);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_freq_limit);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_freq_ramp);
+        al_sfxr_convert2i(frames + i * 2, block, produced);
+        i += produced;
 
-    if (version >= 101) {
-        ok = ok || al_sfxr_readf(reader, userdata, &params->p_freq_dramp);
+        if (produced < count) {
+            break;
+        }
     }
 
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_duty);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_duty_ramp);
+    return i;
+}
+#endif /* AL_SFXR_INT16_STEREO */
 
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_vib_strength);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_vib_speed);
-    float vib_delay; /* unused */
-    ok = ok || al_sfxr_readf(reader, userdata, &vib_delay);
+#if defined(AL_SFXR_FLOAT_MONO)
+size_t al_sfxr_produce1f(al_sfxr_Decoder* const decoder, float* frames, size_t const num_frames) {
+    return al_sfxr_produce_block(decoder, frames, num_frames);
+}
 
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_env_attack);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_env_sustain);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_env_decay);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_env_punch);
+size_t al_sfxr_mix1f(al_sfxr_Decoder* const decoder, float* const frames, size_t const num_frames, float const gain,
+                     int const clamp) {
+    return al_sfxr_voice_mix1f(al_sfxr_ownvoice(decoder), frames, num_frames, gain, clamp);
+}
+#endif /* AL_SFXR_FLOAT_MONO */
 
-    uint8_t filter_on = 0; /* unused */
-    ok = ok || reader(userdata, &filter_on);
+#if defined(AL_SFXR_FLOAT_STEREO)
+void al_sfxr_convert2f(float* const dest, float const* const source, size_t const num_frames) {
+    size_t i = 0;
 
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_lpf_resonance);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_lpf_freq);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_lpf_ramp);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_hpf_freq);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_hpf_ramp);
+#if defined(AL_SFXR_CONVERT_SSE2)
+    for (; i + 4 <= num_frames; i += 4) {
+        __m128 const samples = _mm_loadu_ps(source + i);
+        _mm_storeu_ps(dest + i * 2, _mm_unpacklo_ps(samples, samples));
+        _mm_storeu_ps(dest + i * 2 + 4, _mm_unpackhi_ps(samples, samples));
+    }
+#endif
 
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_pha_offset);
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_pha_ramp);
+    for (; i < num_frames; i++) {
+        dest[i * 2] = source[i];
+        dest[i * 2 + 1] = source[i];
+    }
+}
 
-    ok = ok || al_sfxr_readf(reader, userdata, &params->p_repeat_speed);
+size_t al_sfxr_produce2f(al_sfxr_Decoder* const decoder, float* frames, size_t const num_frames) {
+    size_t i = 0;
 
-    if (version >= 101) {
-        ok = ok || al_sfxr_readf(reader, userdata, &params->p_arp_speed);
-        ok = ok || al_sfxr_readf(reader, userdata, &params->p_arp_mod);
-    }
+    while (i < num_frames) {
+        float block[AL_SFXR_BLOCK_FRAMES];
+        size_t const count = num_frames - i < AL_SFXR_BLOCK_FRAMES ? num_frames - i : AL_SFXR_BLOCK_FRAMES;
+        size_t const produced = al_sfxr_produce_block(decoder, block, count);
 
-    return ok;
-}
-#endif /* AL_SFXR_LOAD */
+        al_sfxr_convert2f(frames + i * 2, block, produced);
+        i += produced;
 
-#if defined(AL_SFXR_GENERATE)
-static void al_sfxr_clamp_value(float* const value, int const bipolar) {
-    if (bipolar) {
-        if (*value < -1.0f) {
-            *value = -1.0f;
-        }
-    }
-    else {
-        if (*value < 0.0f) {
-            *value = 0.0f;
+        if (produced < count) {
+            break;
         }
     }
 
-    if (*value > 1.0f) {
-        *value = 1.0f;
-    }
+    return i;
 }
 
-static void al_sfxr_clamp(al_sfxr_Params* const params) {
-    al_sfxr_clamp_value(&params->p_base_freq, 0);
-    al_sfxr_clamp_value(&params->p_freq_ramp, 1);
-    al_sfxr_clamp_value(&params->p_freq_dramp, 1);
-    al_sfxr_clamp_value(&params->p_duty, 0);
-    al_sfxr_clamp_value(&params->p_duty_ramp, 1);
-    al_sfxr_clamp_value(&params->p_vib_strength, 0);
-    al_sfxr_clamp_value(&params->p_vib_speed, 0);
-    al_sfxr_clamp_value(&params->p_env_attack, 0);
-    al_sfxr_clamp_value(&params->p_env_sustain, 0);
-    al_sfxr_clamp_value(&params->p_env_decay, 0);
-    al_sfxr_clamp_value(&params->p_env_punch, 0);
-    al_sfxr_clamp_value(&params->p_lpf_resonance, 0);
-    al_sfxr_clamp_value(&params->p_lpf_freq, 0);
-    al_sfxr_clamp_value(&params->p_lpf_ramp, 1);
-    al_sfxr_clamp_value(&params->p_hpf_freq, 0);
-    al_sfxr_clamp_value(&params->p_hpf_ramp, 1);
-    al_sfxr_clamp_value(&params->p_pha_offset, 1);
-    al_sfxr_clamp_value(&params->p_pha_ramp, 1);
-    al_sfxr_clamp_value(&params->p_repeat_speed, 0);
-    al_sfxr_clamp_value(&params->p_arp_speed, 0);
-    al_sfxr_clamp_value(&params->p_arp_mod, 1);
+size_t al_sfxr_mix2f(al_sfxr_Decoder* const decoder, float* const frames, size_t const num_frames, float const gain,
+                     float const pan, int const clamp) {
+    return al_sfxr_voice_mix2f(al_sfxr_ownvoice(decoder), frames, num_frames, gain, pan, clamp);
 }
+#endif /* AL_SFXR_FLOAT_STEREO */
 
-static void al_sfxr_mutate(float* const value, al_sfxr_Prng* const prng) {
-    if (al_sfxr_randu(prng, 1)) {
-        *value += al_sfxr_randf(prng, 0.1f) - 0.05f;
+#if defined(AL_SFXR_BATCH)
+#if !defined(AL_SFXR_NO_SIMD)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AL_SFXR_SIMD
+
+typedef __m256 al_sfxr_Vf;
+typedef __m256i al_sfxr_Vi;
+
+#define AL_SFXR_VF_LOAD(p) _mm256_loadu_ps(p)
+#define AL_SFXR_VF_STORE(p, v) _mm256_storeu_ps(p, v)
+#define AL_SFXR_VF_SET1(x) _mm256_set1_ps(x)
+#define AL_SFXR_VF_ADD(a, b) _mm256_add_ps(a, b)
+#define AL_SFXR_VF_SUB(a, b) _mm256_sub_ps(a, b)
+#define AL_SFXR_VF_MUL(a, b) _mm256_mul_ps(a, b)
+#define AL_SFXR_VF_DIV(a, b) _mm256_div_ps(a, b)
+#define AL_SFXR_VF_MIN(a, b) _mm256_min_ps(a, b)
+#define AL_SFXR_VF_MAX(a, b) _mm256_max_ps(a, b)
+#define AL_SFXR_VF_AND(a, b) _mm256_and_ps(a, b)
+#define AL_SFXR_VF_SELECT(m, a, b) _mm256_blendv_ps(b, a, m)
+#define AL_SFXR_VF_LT(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define AL_SFXR_VI_LOAD(p) _mm256_loadu_si256((__m256i const*)(p))
+#define AL_SFXR_VI_STORE(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+#define AL_SFXR_VI_SET1(x) _mm256_set1_epi32(x)
+#define AL_SFXR_VI_ADD(a, b) _mm256_add_epi32(a, b)
+#define AL_SFXR_VI_AND(a, b) _mm256_and_si256(a, b)
+#define AL_SFXR_VI_SUB(a, b) _mm256_sub_epi32(a, b)
+#define AL_SFXR_VI_ANDNOT(a, b) _mm256_andnot_si256(a, b)
+#define AL_SFXR_VI_GT(a, b) _mm256_cmpgt_epi32(a, b)
+#define AL_SFXR_VI_TOF(a) _mm256_cvtepi32_ps(a)
+#define AL_SFXR_VI_ASF(a) _mm256_castsi256_ps(a)
+#define AL_SFXR_VF_TOI(a) _mm256_cvttps_epi32(a)
+#define AL_SFXR_VF_MOVEMASK(a) ((unsigned)_mm256_movemask_ps(a))
+#define AL_SFXR_VF_GATHER(b, i) \
+    _mm256_set_ps(b[i[7]][7], b[i[6]][6], b[i[5]][5], b[i[4]][4], b[i[3]][3], b[i[2]][2], b[i[1]][1], b[i[0]][0])
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AL_SFXR_SIMD
+
+typedef __m128 al_sfxr_Vf;
+typedef __m128i al_sfxr_Vi;
+
+#define AL_SFXR_VF_LOAD(p) _mm_loadu_ps(p)
+#define AL_SFXR_VF_STORE(p, v) _mm_storeu_ps(p, v)
+#define AL_SFXR_VF_SET1(x) _mm_set1_ps(x)
+#define AL_SFXR_VF_ADD(a, b) _mm_add_ps(a, b)
+#define AL_SFXR_VF_SUB(a, b) _mm_sub_ps(a, b)
+#define AL_SFXR_VF_MUL(a, b) _mm_mul_ps(a, b)
+#define AL_SFXR_VF_DIV(a, b) _mm_div_ps(a, b)
+#define AL_SFXR_VF_MIN(a, b) _mm_min_ps(a, b)
+#define AL_SFXR_VF_MAX(a, b) _mm_max_ps(a, b)
+#define AL_SFXR_VF_AND(a, b) _mm_and_ps(a, b)
+#define AL_SFXR_VF_SELECT(m, a, b) _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+#define AL_SFXR_VF_LT(a, b) _mm_cmplt_ps(a, b)
+#define AL_SFXR_VI_LOAD(p) _mm_loadu_si128((__m128i const*)(p))
+#define AL_SFXR_VI_STORE(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define AL_SFXR_VI_SET1(x) _mm_set1_epi32(x)
+#define AL_SFXR_VI_ADD(a, b) _mm_add_epi32(a, b)
+#define AL_SFXR_VI_AND(a, b) _mm_and_si128(a, b)
+#define AL_SFXR_VI_SUB(a, b) _mm_sub_epi32(a, b)
+#define AL_SFXR_VI_ANDNOT(a, b) _mm_andnot_si128(a, b)
+#define AL_SFXR_VI_GT(a, b) _mm_cmpgt_epi32(a, b)
+#define AL_SFXR_VI_TOF(a) _mm_cvtepi32_ps(a)
+#define AL_SFXR_VI_ASF(a) _mm_castsi128_ps(a)
+#define AL_SFXR_VF_TOI(a) _mm_cvttps_epi32(a)
+#define AL_SFXR_VF_MOVEMASK(a) ((unsigned)_mm_movemask_ps(a))
+#define AL_SFXR_VF_GATHER(b, i) _mm_set_ps(b[i[3]][3], b[i[2]][2], b[i[1]][1], b[i[0]][0])
+#endif
+#endif /* !AL_SFXR_NO_SIMD */
+
+void al_sfxr_batch_init(al_sfxr_DecoderBatch* const batch) {
+    memset((void*)batch, 0, sizeof(*batch));
+
+    for (int l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+        batch->period[l] = 8;
     }
 }
 
-void al_sfxr_generate(al_sfxr_Params* const params, al_sfxr_Preset const preset, unsigned const mutations, uint64_t const seed) {
-    static const al_sfxr_Wave wave_types[] = {
-        AL_SFXR_SQUARE,
-        AL_SFXR_SAWTOOTH,
-        AL_SFXR_SINEWAVE,
-        AL_SFXR_NOISE
-    };
-
-    al_sfxr_Prng prng;
-    al_sfxr_newprng(&prng, seed);
-
-    al_sfxr_zero(params);
-
-    switch (preset) {
-        case AL_SFXR_RANDOM:
-            params->wave_type = wave_types[al_sfxr_randu(&prng, 3)];
-            params->p_base_freq = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 2.0f);
-
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_base_freq = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f) + 0.5f;
-            }
-
-            params->p_freq_limit = 0.0f;
-            params->p_freq_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 5.0f);
-
-            if (params->p_base_freq > 0.7f && params->p_freq_ramp > 0.2f) {
-                params->p_freq_ramp = -params->p_freq_ramp;
-            }
+void al_sfxr_batch_start(al_sfxr_DecoderBatch* const batch, unsigned const lane, al_sfxr_Params const* const params, uint64_t const seed) {
+    al_sfxr_Voice* const voice = batch->voices + lane;
+    al_sfxr_Patch* const patch = batch->patches + lane;
+
+    /* The phaser runs on the batch's own delay lines */
+    al_sfxr_compile(patch, params);
+    al_sfxr_startvoice(voice, patch, seed, NULL);
+
+    batch->wave_type[lane] = (int)patch->wave_type;
+    batch->lpf_on[lane] = patch->lpf_on ? -1 : 0;
+    batch->phase[lane] = voice->phase;
+    batch->period[lane] = voice->period;
+    batch->volume[lane] = patch->volume;
+    batch->fltp[lane] = voice->fltp;
+    batch->fltdp[lane] = voice->fltdp;
+    batch->fltw[lane] = voice->fltw;
+    batch->fltw_d[lane] = patch->fltw_d;
+    batch->fltdmp[lane] = patch->fltdmp;
+    batch->fltphp[lane] = voice->fltphp;
+
+    if (patch->wave_type == AL_SFXR_NOISE) {
+        for (int i = 0; i < 32; i++) {
+            batch->noise_buffer[i][lane] = voice->noise_buffer[i];
+        }
+    }
 
-            if (params->p_base_freq < 0.2f && params->p_freq_ramp < -0.05f) {
-                params->p_freq_ramp = -params->p_freq_ramp;
-            }
+    /* The phaser only reads positions relative to the shared write index, so
+       clearing the lane is the same as resetting its own index */
+    for (int i = 0; i < 1024; i++) {
+        batch->phaser_buffer[i][lane] = 0.0f;
+    }
 
-            params->p_freq_dramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
-            params->p_duty = al_sfxr_randf(&prng, 2.0f) - 1.0f;
-            params->p_duty_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
-            params->p_vib_strength = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
-            params->p_vib_speed = al_sfxr_randf(&prng, 2.0f) - 1.0f;
-            params->p_env_attack = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
-            params->p_env_sustain = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 2.0f);
-            params->p_env_decay = al_sfxr_randf(&prng, 2.0f) - 1.0f;
-            params->p_env_punch = pow(al_sfxr_randf(&prng, 0.8f), 2.0f);
+    batch->playing |= 1u << lane;
+}
 
-            if ((params->p_env_attack + params->p_env_sustain + params->p_env_decay) < 0.2f) {
-                params->p_env_sustain += 0.2f + al_sfxr_randf(&prng, 0.3f);
-                params->p_env_decay += 0.2f + al_sfxr_randf(&prng, 0.3f);
-            }
+void al_sfxr_batch_stop(al_sfxr_DecoderBatch* const batch, unsigned const lane) {
+    batch->voices[lane].playing_sample = 0;
+    batch->playing &= ~(1u << lane);
+}
 
-            params->p_lpf_resonance = al_sfxr_randf(&prng, 2.0f) - 1.0f;
-            params->p_lpf_freq = 1.0f - pow(al_sfxr_randf(&prng, 1.0f), 3.0f);
-            params->p_lpf_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
+/* Advances the frame-rate state of all playing lanes, and returns the lanes
+   that are still playing afterwards. */
+static unsigned al_sfxr_batch_step(al_sfxr_DecoderBatch* const batch) {
+    unsigned playing = batch->playing;
 
-            if (params->p_lpf_freq < 0.1f && params->p_lpf_ramp < -0.05f) {
-                params->p_lpf_ramp = -params->p_lpf_ramp;
-            }
+    for (int l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+        if ((playing & (1u << l)) == 0) {
+            continue;
+        }
 
-            params->p_hpf_freq = pow(al_sfxr_randf(&prng, 1.0f), 5.0f);
-            params->p_hpf_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 5.0f);
-            params->p_pha_offset = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
-            params->p_pha_ramp = pow(al_sfxr_randf(&prng, 2.0f) - 1.0f, 3.0f);
-            params->p_repeat_speed = al_sfxr_randf(&prng, 2.0f) - 1.0f;
-            params->p_arp_speed = al_sfxr_randf(&prng, 2.0f) - 1.0f;
-            params->p_arp_mod = al_sfxr_randf(&prng, 2.0f) - 1.0f;
+        al_sfxr_Voice* const voice = batch->voices + l;
+        voice->patch = batch->patches + l;
 
-            break;
+        if (!al_sfxr_events(voice) || !al_sfxr_step(voice, voice->patch->vib_amp > 0.0f, 0)) {
+            playing &= ~(1u << l);
+            continue;
+        }
 
-        case AL_SFXR_PICKUP:
-            params->p_base_freq = 0.4f + al_sfxr_randf(&prng, 0.5f);
-            params->p_env_attack = 0.0f;
-            params->p_env_sustain = al_sfxr_randf(&prng, 0.1f);
-            params->p_env_decay = 0.1f + al_sfxr_randf(&prng, 0.4f);
-            params->p_env_punch = 0.3f + al_sfxr_randf(&prng, 0.3f);
+        voice->rep_time++;
+        voice->arp_time++;
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_arp_speed = 0.5f + al_sfxr_randf(&prng, 0.2f);
-                params->p_arp_mod = 0.2f + al_sfxr_randf(&prng, 0.4f);
-            }
+        int const period = voice->period;
+        int phase = batch->phase[l];
 
-            break;
+        /* The vector loop wraps the phase with a subtraction, so make sure
+           that it's less than two periods after the first increment */
+        if (phase + 1 >= 2 * period) {
+            phase = (phase + 1) % period + period - 1;
+        }
 
-        case AL_SFXR_LASER:
-            params->wave_type = wave_types[al_sfxr_randu(&prng, 2)];
+        batch->phase[l] = phase;
+        batch->period[l] = period;
+        batch->iphase[l] = voice->iphase;
+        batch->square_duty[l] = voice->square_duty;
+        batch->env_vol[l] = voice->env_vol;
+        batch->flthp[l] = voice->flthp;
+    }
 
-            if (params->wave_type == AL_SFXR_SINEWAVE && al_sfxr_randu(&prng, 1)) {
-                params->wave_type = wave_types[al_sfxr_randu(&prng, 1)];
-            }
+    batch->playing = playing;
+    return playing;
+}
 
-            params->p_base_freq = 0.5f + al_sfxr_randf(&prng, 0.5f);
-            params->p_freq_limit = params->p_base_freq - 0.2f - al_sfxr_randf(&prng, 0.6f);
+static void al_sfxr_batch_noise(al_sfxr_DecoderBatch* const batch, unsigned const wrapped) {
+    for (int l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+        if (wrapped & (1u << l)) {
+            al_sfxr_Prng* const prng = &batch->voices[l].prng;
 
-            if (params->p_freq_limit < 0.2f) {
-                params->p_freq_limit = 0.2f;
+            for (int j = 0; j < 32; j++) {
+                batch->noise_buffer[j][l] = al_sfxr_randf(prng, 2.0f) - 1.0f;
             }
+        }
+    }
+}
 
-            params->p_freq_ramp = -0.15f - al_sfxr_randf(&prng, 0.2f);
+#if defined(AL_SFXR_SIMD)
+/* Kept out of line so that the calls to sin don't make the compiler spill the
+   whole filter state around them in the main loop. */
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static al_sfxr_Vf al_sfxr_batch_sine(al_sfxr_Vf const fp, unsigned const sine, al_sfxr_Vf const sample) {
+    float fps[AL_SFXR_BATCH_LANES], samples[AL_SFXR_BATCH_LANES];
+
+    AL_SFXR_VF_STORE(fps, fp);
+    AL_SFXR_VF_STORE(samples, sample);
+
+    for (int l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+        if (sine & (1u << l)) {
+            samples[l] = (float)sin(fps[l] * 2.0f * 3.14159265358979323846f);
+        }
+    }
 
-            if (al_sfxr_randu(&prng, 2) == 0) {
-                params->p_base_freq = 0.3f + al_sfxr_randf(&prng, 0.6f);
-                params->p_freq_limit = al_sfxr_randf(&prng, 0.1f);
-                params->p_freq_ramp = -0.35f - al_sfxr_randf(&prng, 0.3f);
-            }
+    return AL_SFXR_VF_LOAD(samples);
+}
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_duty = al_sfxr_randf(&prng, 0.5f);
-                params->p_duty_ramp = al_sfxr_randf(&prng, 0.2f);
-            }
-            else {
-                params->p_duty = 0.4f + al_sfxr_randf(&prng, 0.5f);
-                params->p_duty_ramp = -al_sfxr_randf(&prng, 0.7f);
-            }
+static float al_sfxr_batch_frame(al_sfxr_DecoderBatch* const batch, unsigned const playing) {
+    unsigned sine = 0, noise = 0;
+    int phaser = 0, lpf = 0;
+    int active[AL_SFXR_BATCH_LANES], square[AL_SFXR_BATCH_LANES], noises[AL_SFXR_BATCH_LANES];
 
-            params->p_env_attack = 0.0f;
-            params->p_env_sustain = 0.1f + al_sfxr_randf(&prng, 0.2f);
-            params->p_env_decay = al_sfxr_randf(&prng, 0.4f);
+    for (int l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+        int const wave_type = batch->wave_type[l];
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_env_punch = al_sfxr_randf(&prng, 0.3f);
-            }
+        active[l] = (playing & (1u << l)) ? -1 : 0;
+        square[l] = wave_type == AL_SFXR_SQUARE ? -1 : 0;
+        noises[l] = wave_type == AL_SFXR_NOISE ? active[l] : 0;
 
-            if (al_sfxr_randu(&prng, 2) == 0) {
-                params->p_pha_offset = al_sfxr_randf(&prng, 0.2f);
-                params->p_pha_ramp = -al_sfxr_randf(&prng, 0.2f);
-            }
+        sine |= (unsigned)(wave_type == AL_SFXR_SINEWAVE && active[l]) << l;
+        noise |= (unsigned)(noises[l] & 1) << l;
+        phaser |= batch->iphase[l];
+        lpf |= batch->lpf_on[l];
+    }
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_hpf_freq = al_sfxr_randf(&prng, 0.3f);
-            }
+    al_sfxr_Vi phase = AL_SFXR_VI_LOAD(batch->phase);
+    al_sfxr_Vi const period = AL_SFXR_VI_LOAD(batch->period);
+    al_sfxr_Vf const periodf = AL_SFXR_VI_TOF(period);
+    al_sfxr_Vf const square_duty = AL_SFXR_VF_LOAD(batch->square_duty);
+    al_sfxr_Vf const env_vol = AL_SFXR_VF_LOAD(batch->env_vol);
+    al_sfxr_Vf const fltw_d = AL_SFXR_VF_LOAD(batch->fltw_d);
+    al_sfxr_Vf const fltdmp = AL_SFXR_VF_LOAD(batch->fltdmp);
+    al_sfxr_Vf const flthp = AL_SFXR_VF_LOAD(batch->flthp);
+    al_sfxr_Vf const lpf_on = AL_SFXR_VI_ASF(AL_SFXR_VI_LOAD(batch->lpf_on));
+    al_sfxr_Vf const square_mask = AL_SFXR_VI_ASF(AL_SFXR_VI_LOAD(square));
+    al_sfxr_Vf const noise_mask = AL_SFXR_VI_ASF(AL_SFXR_VI_LOAD(noises));
+    al_sfxr_Vi const iphase = AL_SFXR_VI_LOAD(batch->iphase);
+
+    al_sfxr_Vf fltp = AL_SFXR_VF_LOAD(batch->fltp);
+    al_sfxr_Vf fltdp = AL_SFXR_VF_LOAD(batch->fltdp);
+    al_sfxr_Vf fltw = AL_SFXR_VF_LOAD(batch->fltw);
+    al_sfxr_Vf fltphp = AL_SFXR_VF_LOAD(batch->fltphp);
+    al_sfxr_Vf ssample = AL_SFXR_VF_SET1(0.0f);
+
+    al_sfxr_Vi const one = AL_SFXR_VI_SET1(1);
+    al_sfxr_Vf const zero = AL_SFXR_VF_SET1(0.0f);
+    al_sfxr_Vf const half = AL_SFXR_VF_SET1(0.5f);
+    al_sfxr_Vf const minus_half = AL_SFXR_VF_SET1(-0.5f);
+    al_sfxr_Vf const onef = AL_SFXR_VF_SET1(1.0f);
+    al_sfxr_Vf const twof = AL_SFXR_VF_SET1(2.0f);
+    al_sfxr_Vf const max_fltw = AL_SFXR_VF_SET1(0.1f);
+
+    int ipp = batch->ipp;
 
-            break;
+    /* 8x supersampling */
+    for (int si = 0; si < 8; si++) {
+        phase = AL_SFXR_VI_ADD(phase, one);
+        al_sfxr_Vi const inside = AL_SFXR_VI_GT(period, phase);
+        phase = AL_SFXR_VI_SUB(phase, AL_SFXR_VI_ANDNOT(inside, period));
 
-        case AL_SFXR_EXPLOSION:
-            params->wave_type = AL_SFXR_NOISE;
+        if (noise != 0) {
+            unsigned const wrapped = ~AL_SFXR_VF_MOVEMASK(AL_SFXR_VI_ASF(inside)) & noise;
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_base_freq = 0.1f + al_sfxr_randf(&prng, 0.4f);
-                params->p_freq_ramp = -0.1f + al_sfxr_randf(&prng, 0.4f);
-            }
-            else {
-                params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.7f);
-                params->p_freq_ramp = -0.2f - al_sfxr_randf(&prng, 0.2f);
+            if (wrapped != 0) {
+                al_sfxr_batch_noise(batch, wrapped);
             }
+        }
 
-            params->p_base_freq *= params->p_base_freq;
-
-            if (al_sfxr_randu(&prng, 4) == 0) {
-                params->p_freq_ramp=0.0f;
-            }
+        /* Base waveform */
+        al_sfxr_Vf const fp = AL_SFXR_VF_DIV(AL_SFXR_VI_TOF(phase), periodf);
+        al_sfxr_Vf const square_sample = AL_SFXR_VF_SELECT(AL_SFXR_VF_LT(fp, square_duty), half, minus_half);
+        al_sfxr_Vf const sawtooth_sample = AL_SFXR_VF_SUB(onef, AL_SFXR_VF_MUL(fp, twof));
+        al_sfxr_Vf sample = AL_SFXR_VF_SELECT(square_mask, square_sample, sawtooth_sample);
+
+        if (noise != 0) {
+            /* Periods are much smaller than 2^24 / 32, so truncating fp * 32
+               gives the same index as phase * 32 / period */
+            int indices[AL_SFXR_BATCH_LANES];
+            al_sfxr_Vi const index = AL_SFXR_VF_TOI(AL_SFXR_VF_MUL(fp, AL_SFXR_VF_SET1(32.0f)));
+            AL_SFXR_VI_STORE(indices, AL_SFXR_VI_AND(index, AL_SFXR_VI_SET1(31)));
+            sample = AL_SFXR_VF_SELECT(noise_mask, AL_SFXR_VF_GATHER(batch->noise_buffer, indices), sample);
+        }
 
-            if (al_sfxr_randu(&prng, 2) == 0) {
-                params->p_repeat_speed = 0.3f + al_sfxr_randf(&prng, 0.5f);
-            }
+        if (sine != 0) {
+            sample = al_sfxr_batch_sine(fp, sine, sample);
+        }
 
-            params->p_env_attack = 0.0f;
-            params->p_env_sustain = 0.1f + al_sfxr_randf(&prng, 0.3f);
-            params->p_env_decay = al_sfxr_randf(&prng, 0.5f);
+        /* Low-pass filter, lanes that bypass it just copy the sample */
+        al_sfxr_Vf const pp = fltp;
 
-            if (al_sfxr_randu(&prng, 1) == 0) {
-                params->p_pha_offset = -0.3f + al_sfxr_randf(&prng, 0.9f);
-                params->p_pha_ramp = -al_sfxr_randf(&prng, 0.3f);
-            }
+        if (lpf) {
+            fltw = AL_SFXR_VF_MUL(fltw, fltw_d);
+            fltw = AL_SFXR_VF_MAX(zero, fltw);
+            fltw = AL_SFXR_VF_MIN(max_fltw, fltw);
 
-            params->p_env_punch = 0.2f + al_sfxr_randf(&prng, 0.6f);
+            al_sfxr_Vf dp = AL_SFXR_VF_ADD(fltdp, AL_SFXR_VF_MUL(AL_SFXR_VF_SUB(sample, fltp), fltw));
+            dp = AL_SFXR_VF_SUB(dp, AL_SFXR_VF_MUL(dp, fltdmp));
+            fltp = AL_SFXR_VF_SELECT(lpf_on, AL_SFXR_VF_ADD(fltp, dp), sample);
+            fltdp = AL_SFXR_VF_AND(lpf_on, dp);
+        }
+        else {
+            fltp = sample;
+        }
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_vib_strength = al_sfxr_randf(&prng, 0.7f);
-                params->p_vib_speed = al_sfxr_randf(&prng, 0.6f);
-            }
+        /* High-pass filter */
+        fltphp = AL_SFXR_VF_ADD(fltphp, AL_SFXR_VF_SUB(fltp, pp));
+        fltphp = AL_SFXR_VF_SUB(fltphp, AL_SFXR_VF_MUL(fltphp, flthp));
+        sample = fltphp;
+
+        /* Phaser, a zero offset reads back the sample just written */
+        AL_SFXR_VF_STORE(batch->phaser_buffer[ipp & 1023], sample);
+
+        if (phaser) {
+            int indices[AL_SFXR_BATCH_LANES];
+            al_sfxr_Vi const index = AL_SFXR_VI_SUB(AL_SFXR_VI_SET1(ipp + 1024), iphase);
+            AL_SFXR_VI_STORE(indices, AL_SFXR_VI_AND(index, AL_SFXR_VI_SET1(1023)));
+            sample = AL_SFXR_VF_ADD(sample, AL_SFXR_VF_GATHER(batch->phaser_buffer, indices));
+        }
+        else {
+            sample = AL_SFXR_VF_ADD(sample, sample);
+        }
 
-            if (al_sfxr_randu(&prng, 2) == 0) {
-                params->p_arp_speed = 0.6f + al_sfxr_randf(&prng, 0.3f);
-                params->p_arp_mod = 0.8f - al_sfxr_randf(&prng, 1.6f);
-            }
+        ipp = (ipp + 1) & 1023;
 
-            break;
+        /* Final accumulation and envelope application */
+        ssample = AL_SFXR_VF_ADD(ssample, AL_SFXR_VF_MUL(sample, env_vol));
+    }
 
-        case AL_SFXR_POWERUP:
-            if (al_sfxr_randu(&prng, 1)) {
-                params->wave_type = AL_SFXR_SAWTOOTH;
-            }
-            else {
-                params->p_duty = al_sfxr_randf(&prng, 0.6f);
-            }
+    ssample = AL_SFXR_VF_DIV(ssample, AL_SFXR_VF_SET1(8.0f));
+    ssample = AL_SFXR_VF_MUL(ssample, AL_SFXR_VF_LOAD(batch->volume));
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.3f);
-                params->p_freq_ramp = 0.1f + al_sfxr_randf(&prng, 0.4f);
-                params->p_repeat_speed = 0.4f + al_sfxr_randf(&prng, 0.4f);
-            }
-            else {
-                params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.3f);
-                params->p_freq_ramp = 0.05f + al_sfxr_randf(&prng, 0.2f);
+    /* Operand order keeps NaNs, like the scalar comparisons */
+    ssample = AL_SFXR_VF_MIN(onef, ssample);
+    ssample = AL_SFXR_VF_MAX(AL_SFXR_VF_SET1(-1.0f), ssample);
+    ssample = AL_SFXR_VF_AND(AL_SFXR_VI_ASF(AL_SFXR_VI_LOAD(active)), ssample);
 
-                if (al_sfxr_randu(&prng, 1)) {
-                    params->p_vib_strength = al_sfxr_randf(&prng, 0.7f);
-                    params->p_vib_speed = al_sfxr_randf(&prng, 0.6f);
-                }
-            }
+    AL_SFXR_VI_STORE(batch->phase, phase);
+    AL_SFXR_VF_STORE(batch->fltp, fltp);
+    AL_SFXR_VF_STORE(batch->fltdp, fltdp);
+    AL_SFXR_VF_STORE(batch->fltw, fltw);
+    AL_SFXR_VF_STORE(batch->fltphp, fltphp);
+    batch->ipp = ipp;
 
-            params->p_env_attack = 0.0f;
-            params->p_env_sustain = al_sfxr_randf(&prng, 0.4f);
-            params->p_env_decay = 0.1f + al_sfxr_randf(&prng, 0.4f);
-            break;
+    float samples[AL_SFXR_BATCH_LANES];
+    AL_SFXR_VF_STORE(samples, ssample);
 
-        case AL_SFXR_HIT:
-            params->wave_type = wave_types[al_sfxr_randu(&prng, 2)];
+    float mix = 0.0f;
 
-            if (params->wave_type == AL_SFXR_SINEWAVE) {
-                params->wave_type = AL_SFXR_NOISE;
-            }
+    for (int l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+        mix += samples[l];
+    }
 
-            if (params->wave_type == AL_SFXR_SQUARE) {
-                params->p_duty = al_sfxr_randf(&prng, 0.6f);
-            }
+    return mix;
+}
+#else
+static float al_sfxr_batch_frame(al_sfxr_DecoderBatch* const batch, unsigned const playing) {
+    float ssample[AL_SFXR_BATCH_LANES] = {0.0f};
+    int ipp = batch->ipp;
 
-            params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.6f);
-            params->p_freq_ramp = -0.3f - al_sfxr_randf(&prng, 0.4f);
-            params->p_env_attack = 0.0f;
-            params->p_env_sustain = al_sfxr_randf(&prng, 0.1f);
-            params->p_env_decay = 0.1f + al_sfxr_randf(&prng, 0.2f);
+    /* 8x supersampling, one lane at a time */
+    for (int si = 0; si < 8; si++) {
+        for (int l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+            int const period = batch->period[l];
+            int const wave_type = batch->wave_type[l];
+            float sample = 0.0f;
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_hpf_freq = al_sfxr_randf(&prng, 0.3f);
+            if (++batch->phase[l] >= period) {
+                batch->phase[l] -= period;
+
+                if (wave_type == AL_SFXR_NOISE && (playing & (1u << l))) {
+                    al_sfxr_batch_noise(batch, 1u << l);
+                }
             }
 
-            break;
+            /* Base waveform */
+            int const phase = batch->phase[l];
+            float fp = (float)phase / period;
 
-        case AL_SFXR_JUMP:
-            params->wave_type = AL_SFXR_SQUARE;
-            params->p_duty = al_sfxr_randf(&prng, 0.6f);
-            params->p_base_freq = 0.3f + al_sfxr_randf(&prng, 0.3f);
-            params->p_freq_ramp = 0.1f + al_sfxr_randf(&prng, 0.2f);
-            params->p_env_attack = 0.0f;
-            params->p_env_sustain = 0.1f + al_sfxr_randf(&prng, 0.3f);
-            params->p_env_decay = 0.1f + al_sfxr_randf(&prng, 0.2f);
+            switch (wave_type) {
+                case AL_SFXR_SQUARE:   sample = fp < batch->square_duty[l] ? 0.5f : -0.5f; break;
+                case AL_SFXR_SAWTOOTH: sample = 1.0f - fp * 2.0f; break;
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_hpf_freq = al_sfxr_randf(&prng, 0.3f);
-            }
+                case AL_SFXR_SINEWAVE:
+                    if (playing & (1u << l)) {
+                        sample = (float)sin(fp * 2.0f * 3.14159265358979323846f);
+                    }
 
-            if (al_sfxr_randu(&prng, 1)) {
-                params->p_lpf_freq = 1.0f - al_sfxr_randf(&prng, 0.6f);
+                    break;
+
+                case AL_SFXR_NOISE:
+                    if (playing & (1u << l)) {
+                        sample = batch->noise_buffer[phase * 32 / period][l];
+                    }
+
+                    break;
             }
 
-            break;
+            /* Low-pass filter */
+            float const pp = batch->fltp[l];
 
-        case AL_SFXR_BLIP:
-            params->wave_type = wave_types[al_sfxr_randu(&prng, 1)];
+            if (batch->lpf_on[l]) {
+                batch->fltw[l] *= batch->fltw_d[l];
 
-            if (params->wave_type == AL_SFXR_SQUARE) {
-                params->p_duty = al_sfxr_randf(&prng, 0.6f);
-            }
+                if (batch->fltw[l] < 0.0f) {
+                    batch->fltw[l] = 0.0f;
+                }
 
-            params->p_base_freq = 0.2f + al_sfxr_randf(&prng, 0.4f);
-            params->p_env_attack = 0.0f;
-            params->p_env_sustain = 0.1f + al_sfxr_randf(&prng, 0.1f);
-            params->p_env_decay = al_sfxr_randf(&prng, 0.2f);
-            params->p_hpf_freq = 0.1f;
+                if (batch->fltw[l] > 0.1f) {
+                    batch->fltw[l] = 0.1f;
+                }
 
-            break;
-    }
+                batch->fltdp[l] += (sample - batch->fltp[l]) * batch->fltw[l];
+                batch->fltdp[l] -= batch->fltdp[l] * batch->fltdmp[l];
+                batch->fltp[l] += batch->fltdp[l];
+            }
+            else {
+                batch->fltp[l] = sample;
+                batch->fltdp[l] = 0.0f;
+            }
 
-    al_sfxr_clamp(params);
+            /* High-pass filter */
+            batch->fltphp[l] += batch->fltp[l] - pp;
+            batch->fltphp[l] -= batch->fltphp[l] * batch->flthp[l];
+            sample = batch->fltphp[l];
 
-    for (unsigned i = 0; i < mutations; i++) {
-        al_sfxr_mutate(&params->p_base_freq, &prng);
-        al_sfxr_mutate(&params->p_freq_ramp, &prng);
-        al_sfxr_mutate(&params->p_freq_dramp, &prng);
-        al_sfxr_mutate(&params->p_duty, &prng);
-        al_sfxr_mutate(&params->p_duty_ramp, &prng);
-        al_sfxr_mutate(&params->p_vib_strength, &prng);
-        al_sfxr_mutate(&params->p_vib_speed, &prng);
-        al_sfxr_mutate(&params->p_env_attack, &prng);
-        al_sfxr_mutate(&params->p_env_sustain, &prng);
-        al_sfxr_mutate(&params->p_env_decay, &prng);
-        al_sfxr_mutate(&params->p_env_punch, &prng);
-        al_sfxr_mutate(&params->p_lpf_resonance, &prng);
-        al_sfxr_mutate(&params->p_lpf_freq, &prng);
-        al_sfxr_mutate(&params->p_lpf_ramp, &prng);
-        al_sfxr_mutate(&params->p_hpf_freq, &prng);
-        al_sfxr_mutate(&params->p_hpf_ramp, &prng);
-        al_sfxr_mutate(&params->p_pha_offset, &prng);
-        al_sfxr_mutate(&params->p_pha_ramp, &prng);
-        al_sfxr_mutate(&params->p_repeat_speed, &prng);
-        al_sfxr_mutate(&params->p_arp_speed, &prng);
-        al_sfxr_mutate(&params->p_arp_mod, &prng);
+            /* Phaser */
+            batch->phaser_buffer[ipp & 1023][l] = sample;
+            sample += batch->phaser_buffer[(ipp - batch->iphase[l] + 1024) & 1023][l];
 
-        al_sfxr_clamp(params);
+            /* Final accumulation and envelope application */
+            ssample[l] += sample * batch->env_vol[l];
+        }
+
+        ipp = (ipp + 1) & 1023;
     }
-}
-#endif /* AL_SFXR_GENERATE */
 
-#if defined(AL_SFXR_SAVE)
-static int al_sfxr_write16(al_sfxr_Write8 const writer, void* const userdata, uint16_t const value) {
-    int ok = writer(userdata, value & 0xff);
-    return ok || writer(userdata, value >> 8);
-}
+    batch->ipp = ipp;
+    float mix = 0.0f;
 
-static int al_sfxr_write32(al_sfxr_Write8 const writer, void* const userdata, uint32_t const value) {
-    int ok = al_sfxr_write16(writer, userdata, value & 0xffff);
-    return ok || al_sfxr_write16(writer, userdata, value >> 16);
-}
+    for (int l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+        if (playing & (1u << l)) {
+            float sample = ssample[l] / 8;
+            sample *= batch->volume[l];
 
-static int al_sfxr_writef(al_sfxr_Write8 const writer, void* const userdata, float const value) {
-    uint32_t dword;
-    memcpy((void*)&dword, (void*)&value, sizeof(dword));
+            if (sample > 1.0f) {
+                sample = 1.0f;
+            }
+            else if (sample < -1.0f) {
+                sample = -1.0f;
+            }
 
-    return al_sfxr_write32(writer, userdata, dword);
-}
+            mix += sample;
+        }
+    }
 
-static int al_sfxr_writei(al_sfxr_Write8 const writer, void* const userdata, int const value) {
-    uint32_t temp = (uint32_t)value;
-    return al_sfxr_write32(writer, userdata, temp);
+    return mix;
 }
+#endif /* AL_SFXR_SIMD */
 
-int al_sfxr_save(al_sfxr_Params const* const params, al_sfxr_Write8 const writer, void* const userdata) {
-    int ok = al_sfxr_writei(writer, userdata, 102); /* version */
-    ok = ok || al_sfxr_writei(writer, userdata, (int)params->wave_type);
-
-    ok = ok || al_sfxr_writef(writer, userdata, params->sound_vol);
+unsigned al_sfxr_batch_produce(al_sfxr_DecoderBatch* const batch, float* const frames, size_t const num_frames) {
+    for (size_t i = 0; i < num_frames; i++) {
+        unsigned const playing = batch->playing != 0 ? al_sfxr_batch_step(batch) : 0;
+        frames[i] = playing != 0 ? al_sfxr_batch_frame(batch, playing) : 0.0f;
+    }
 
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_base_freq);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_freq_limit);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_freq_ramp);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_freq_dramp);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_duty);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_duty_ramp);
+    return batch->playing;
+}
 
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_vib_strength);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_vib_speed);
-    ok = ok || al_sfxr_writef(writer, userdata, 0.0f); /* vib_delay, unused */
+#endif /* AL_SFXR_BATCH */
 
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_env_attack);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_env_sustain);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_env_decay);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_env_punch);
+#if defined(AL_SFXR_CACHE)
+#if !defined(AL_SFXR_MALLOC)
+#define AL_SFXR_MALLOC(size) malloc(size)
+#define AL_SFXR_FREE(ptr) free(ptr)
+#endif
 
-    ok = ok || writer(userdata, 0); /* filter_on, unused */
+/* FNV-1a */
+static uint64_t al_sfxr_hash(void const* const data, size_t const size, uint64_t hash) {
+    uint8_t const* const bytes = (uint8_t const*)data;
 
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_lpf_resonance);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_lpf_freq);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_lpf_ramp);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_hpf_freq);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_hpf_ramp);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * UINT64_C(0x100000001b3);
+    }
 
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_pha_offset);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_pha_ramp);
+    return hash;
+}
 
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_repeat_speed);
+/* Adds the entry to the newest end of the LRU list */
+static void al_sfxr_cache_link(al_sfxr_Cache* const cache, al_sfxr_CacheEntry* const entry) {
+    entry->older = cache->newest;
+    entry->newer = NULL;
 
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_arp_speed);
-    ok = ok || al_sfxr_writef(writer, userdata, params->p_arp_mod);
+    if (cache->newest != NULL) {
+        cache->newest->newer = entry;
+    }
+    else {
+        cache->oldest = entry;
+    }
 
-    return ok;
+    cache->newest = entry;
 }
-#endif /* AL_SFXR_SAVE */
 
-static void al_sfxr_resetsample(al_sfxr_Decoder* const decoder, int const restart) {
-    if (!restart) {
-        decoder->phase = 0;
+static void al_sfxr_cache_unlink(al_sfxr_Cache* const cache, al_sfxr_CacheEntry* const entry) {
+    if (entry->older != NULL) {
+        entry->older->newer = entry->newer;
+    }
+    else {
+        cache->oldest = entry->newer;
     }
 
-    decoder->fperiod = 100.0 / (decoder->params.p_base_freq * decoder->params.p_base_freq + 0.001);
-    decoder->period = (int)decoder->fperiod;
-    decoder->fmaxperiod = 100.0 / (decoder->params.p_freq_limit * decoder->params.p_freq_limit + 0.001);
-    decoder->fslide = 1.0 - pow((double)decoder->params.p_freq_ramp, 3.0) * 0.01;
-    decoder->fdslide = -pow((double)decoder->params.p_freq_dramp, 3.0) * 0.000001;
-    decoder->square_duty = 0.5f - decoder->params.p_duty * 0.5f;
-    decoder->square_slide = -decoder->params.p_duty_ramp * 0.00005f;
-
-    if (decoder->params.p_arp_mod >= 0.0f) {
-        decoder->arp_mod = 1.0 - pow((double)decoder->params.p_arp_mod, 2.0) * 0.9;
+    if (entry->newer != NULL) {
+        entry->newer->older = entry->older;
     }
     else {
-        decoder->arp_mod = 1.0 + pow((double)decoder->params.p_arp_mod, 2.0) * 10.0;
+        cache->newest = entry->older;
     }
+}
 
-    decoder->arp_time = 0;
-    decoder->arp_limit = (int)(pow(1.0f - decoder->params.p_arp_speed, 2.0f) * 20000 + 32);
+/* Frees the least recently used sounds that are not acquired until the cache
+   is within its budget */
+static void al_sfxr_cache_evict(al_sfxr_Cache* const cache) {
+    al_sfxr_CacheEntry* entry = cache->oldest;
 
-    if (decoder->params.p_arp_speed == 1.0f) {
-        decoder->arp_limit = 0;
-    }
+    while (entry != NULL && cache->bytes > cache->budget) {
+        al_sfxr_CacheEntry* const newer = entry->newer;
 
-    if (!restart) {
-        /* Reset filter */
-        decoder->fltp = 0.0f;
-        decoder->fltdp = 0.0f;
-        decoder->fltw = pow(decoder->params.p_lpf_freq, 3.0f) * 0.1f;
-        decoder->fltw_d = 1.0f + decoder->params.p_lpf_ramp * 0.0001f;
-        decoder->fltdmp = 5.0f / (1.0f + pow(decoder->params.p_lpf_resonance, 2.0f) * 20.0f) * (0.01f + decoder->fltw);
+        if (entry->refs == 0) {
+            al_sfxr_CacheEntry** prev = cache->buckets + entry->hash % AL_SFXR_CACHE_BUCKETS;
+
+            while (*prev != entry) {
+                prev = &(*prev)->next;
+            }
 
-        if (decoder->fltdmp > 0.8f) {
-            decoder->fltdmp = 0.8f;
+            *prev = entry->next;
+            al_sfxr_cache_unlink(cache, entry);
+
+            cache->bytes -= entry->bytes;
+            cache->evictions++;
+            AL_SFXR_FREE(entry);
         }
 
-        decoder->fltphp = 0.0f;
-        decoder->flthp = pow(decoder->params.p_hpf_freq, 2.0f) * 0.1f;
-        decoder->flthp_d = 1.0 + decoder->params.p_hpf_ramp * 0.0003f;
+        entry = newer;
+    }
+}
 
-        /* Reset vibrato */
-        decoder->vib_phase = 0.0f;
-        decoder->vib_speed = pow(decoder->params.p_vib_speed, 2.0f) * 0.01f;
-        decoder->vib_amp = decoder->params.p_vib_strength * 0.5f;
+void al_sfxr_cache_init(al_sfxr_Cache* const cache, size_t const budget) {
+    memset((void*)cache, 0, sizeof(*cache));
+    cache->budget = budget;
+}
 
-        /* Reset envelope */
-        decoder->env_vol = 0.0f;
-        decoder->env_stage = 0;
-        decoder->env_time = 0;
-        decoder->env_length[0] = (int)(decoder->params.p_env_attack * decoder->params.p_env_attack * 100000.0f);
-        decoder->env_length[1] = (int)(decoder->params.p_env_sustain * decoder->params.p_env_sustain * 100000.0f);
-        decoder->env_length[2] = (int)(decoder->params.p_env_decay * decoder->params.p_env_decay * 100000.0f);
+void al_sfxr_cache_destroy(al_sfxr_Cache* const cache) {
+    al_sfxr_CacheEntry* entry = cache->oldest;
 
-        decoder->fphase = pow(decoder->params.p_pha_offset, 2.0f) * 1020.0f;
+    while (entry != NULL) {
+        al_sfxr_CacheEntry* const newer = entry->newer;
+        AL_SFXR_FREE(entry);
+        entry = newer;
+    }
 
-        if (decoder->params.p_pha_offset < 0.0f) {
-            decoder->fphase = -decoder->fphase;
-        }
+    al_sfxr_cache_init(cache, cache->budget);
+}
 
-        decoder->fdphase = pow(decoder->params.p_pha_ramp, 2.0f) * 1.0f;
+al_sfxr_CacheEntry const* al_sfxr_cache_acquire(al_sfxr_Cache* const cache, al_sfxr_Params const* const params, uint64_t const seed) {
+    uint64_t hash = al_sfxr_hash(params, sizeof(*params), UINT64_C(0xcbf29ce484222325));
+    hash = al_sfxr_hash(&seed, sizeof(seed), hash);
 
-        if (decoder->params.p_pha_ramp < 0.0f) {
-            decoder->fdphase = -decoder->fdphase;
-        }
+    al_sfxr_CacheEntry** const bucket = cache->buckets + hash % AL_SFXR_CACHE_BUCKETS;
 
-        decoder->iphase = abs((int)decoder->fphase);
-        decoder->ipp = 0;
+    for (al_sfxr_CacheEntry* entry = *bucket; entry != NULL; entry = entry->next) {
+        if (entry->hash == hash && entry->seed == seed && memcmp(&entry->params, params, sizeof(*params)) == 0) {
+            al_sfxr_cache_unlink(cache, entry);
+            al_sfxr_cache_link(cache, entry);
 
-        for (int i = 0; i < 1024; i++) {
-            decoder->phaser_buffer[i] = 0.0f;
+            entry->refs++;
+            cache->hits++;
+            return entry;
         }
+    }
 
-        for(int i = 0; i < 32; i++) {
-            decoder->noise_buffer[i] = al_sfxr_randf(&decoder->prng, 2.0f) - 1.0f;
-        }
+    cache->misses++;
 
-        decoder->rep_time = 0;
-        decoder->rep_limit = (int)(pow(1.0f - decoder->params.p_repeat_speed, 2.0f) * 20000 + 32);
+    /* The frames are allocated right after the entry */
+    size_t const num_frames = al_sfxr_length(params);
+    size_t const bytes = sizeof(al_sfxr_CacheEntry) + num_frames * sizeof(float);
+    al_sfxr_CacheEntry* const entry = (al_sfxr_CacheEntry*)AL_SFXR_MALLOC(bytes);
 
-        if (decoder->params.p_repeat_speed == 0.0f) {
-            decoder->rep_limit = 0;
-        }
+    if (entry == NULL) {
+        return NULL;
     }
-}
-
-void al_sfxr_start(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params, uint64_t const seed) {
-    decoder->params = *params;
-    al_sfxr_newprng(&decoder->prng, seed);
-    al_sfxr_resetsample(decoder, 0);
 
-    decoder->playing_sample = 1;
+    float* const frames = (float*)(entry + 1);
+    al_sfxr_Decoder decoder;
+    al_sfxr_start(&decoder, params, seed);
+
+    entry->frames = frames;
+    entry->num_frames = al_sfxr_produce_block(&decoder, frames, num_frames);
+    entry->params = *params;
+    entry->seed = seed;
+    entry->hash = hash;
+    entry->bytes = bytes;
+    entry->refs = 1;
+    entry->next = *bucket;
+    *bucket = entry;
+
+    al_sfxr_cache_link(cache, entry);
+    cache->bytes += bytes;
+    al_sfxr_cache_evict(cache);
+    return entry;
 }
 
-void al_sfxr_start_quick(al_sfxr_Decoder* const decoder, al_sfxr_Params const* const params) {
-    al_sfxr_start(decoder, params, UINT64_C(0x89866ae81aa30a2b));
+void al_sfxr_cache_release(al_sfxr_Cache* const cache, al_sfxr_CacheEntry const* const entry) {
+    ((al_sfxr_CacheEntry*)entry)->refs--;
+    al_sfxr_cache_evict(cache);
+}
+#endif /* AL_SFXR_CACHE */
+
+#if defined(AL_SFXR_MIXER)
+void al_sfxr_mixer_init(al_sfxr_Mixer* const mixer, al_sfxr_MixerVoice* const voices, unsigned const num_voices,
+                        al_sfxr_PhaserLine* const lines, size_t const num_lines) {
+    mixer->voices = voices;
+    mixer->num_voices = num_voices;
+    mixer->polyphony = num_voices;
+    mixer->next_id = 1;
+    mixer->clock = 0;
+    mixer->mode = 0;
+    al_sfxr_pool_init(&mixer->pool, lines, num_lines);
+
+    for (unsigned i = 0; i < num_voices; i++) {
+        voices[i].id = 0;
+        voices[i].voice.phaser_buffer = NULL;
+    }
 }
 
-void al_sfxr_restart(al_sfxr_Decoder* const decoder) {
-    al_sfxr_resetsample(decoder, 0);
+static void al_sfxr_mixer_free(al_sfxr_Mixer* const mixer, al_sfxr_MixerVoice* const voice) {
+    al_sfxr_voice_stop(&voice->voice, &mixer->pool);
+    voice->id = 0;
 }
 
-#if defined(AL_SFXR_INT16_MONO) || defined(AL_SFXR_INT16_STEREO) || \
-    defined(AL_SFXR_FLOAT_MONO) || defined(AL_SFXR_FLOAT_STEREO)
-static float al_sfxr_produce(al_sfxr_Decoder* const decoder) {
-    if (!decoder->playing_sample) {
-        return 0.0f;
-    }
+/* Returns the playing voice that is stolen first, optionally only among the
+   voices that hold a phaser delay line */
+static al_sfxr_MixerVoice* al_sfxr_mixer_victim(al_sfxr_Mixer* const mixer, int const with_phaser) {
+    al_sfxr_MixerVoice* victim = NULL;
 
-    decoder->rep_time++;
+    for (unsigned i = 0; i < mixer->num_voices; i++) {
+        al_sfxr_MixerVoice* const voice = mixer->voices + i;
 
-    if (decoder->rep_limit != 0 && decoder->rep_time >= decoder->rep_limit) {
-        decoder->rep_time = 0;
-        al_sfxr_resetsample(decoder, 1);
-    }
+        if (voice->id == 0 || (with_phaser && voice->voice.phaser_buffer == NULL)) {
+            continue;
+        }
 
-    /* Frequency envelopes/arpeggios */
-    decoder->arp_time++;
+        if (victim == NULL || voice->priority < victim->priority ||
+            (voice->priority == victim->priority && mixer->clock - voice->started > mixer->clock - victim->started)) {
 
-    if (decoder->arp_limit != 0 && decoder->arp_time >= decoder->arp_limit) {
-        decoder->arp_limit = 0;
-        decoder->fperiod *= decoder->arp_mod;
+            victim = voice;
+        }
     }
 
-    decoder->fslide += decoder->fdslide;
-    decoder->fperiod *= decoder->fslide;
+    return victim;
+}
 
-    if (decoder->fperiod > decoder->fmaxperiod) {
-        decoder->fperiod = decoder->fmaxperiod;
+void al_sfxr_mixer_set_polyphony(al_sfxr_Mixer* const mixer, unsigned const polyphony) {
+    mixer->polyphony = polyphony < mixer->num_voices ? polyphony : mixer->num_voices;
+    unsigned playing = 0;
 
-        if (decoder->params.p_freq_limit > 0.0f) {
-            decoder->playing_sample = 0;
-            return 0.0f;
-        }
+    for (unsigned i = 0; i < mixer->num_voices; i++) {
+        playing += mixer->voices[i].id != 0;
+    }
+
+    for (; playing > mixer->polyphony; playing--) {
+        al_sfxr_mixer_free(mixer, al_sfxr_mixer_victim(mixer, 0));
     }
+}
 
-    float rfperiod = decoder->fperiod;
+/* Returns a new voice id, can be called from any thread */
+static unsigned al_sfxr_mixer_newid(al_sfxr_Mixer* const mixer) {
+    unsigned id;
 
-    if (decoder->vib_amp > 0.0f) {
-        decoder->vib_phase += decoder->vib_speed;
-        rfperiod = decoder->fperiod * (1.0 + sin(decoder->vib_phase) * decoder->vib_amp);
+    do {
+        id = al_sfxr_atomic_inc(&mixer->next_id);
     }
+    while (id == 0);
+
+    return id;
+}
 
-    decoder->period = (int)rfperiod;
+/* Starts playing a patch with the given id */
+static unsigned al_sfxr_mixer_start(al_sfxr_Mixer* const mixer, unsigned const id, al_sfxr_Patch const* const patch,
+                                    uint64_t const seed, float const gain, int const priority) {
+    al_sfxr_MixerVoice* free_voice = NULL;
+    unsigned playing = 0;
 
-    if (decoder->period < 8) {
-        decoder->period = 8;
+    for (unsigned i = 0; i < mixer->num_voices; i++) {
+        if (mixer->voices[i].id != 0) {
+            playing++;
+        }
+        else if (free_voice == NULL) {
+            free_voice = mixer->voices + i;
+        }
     }
 
-    decoder->square_duty += decoder->square_slide;
+    al_sfxr_MixerVoice* voice = free_voice;
 
-    if (decoder->square_duty < 0.0f) {
-        decoder->square_duty = 0.0f;
+    if (playing >= mixer->polyphony || voice == NULL) {
+        voice = al_sfxr_mixer_victim(mixer, 0);
     }
 
-    if (decoder->square_duty > 0.5f) {
-        decoder->square_duty = 0.5f;
+    if (voice == NULL || (voice->id != 0 && voice->priority > priority)) {
+        return 0;
     }
 
-    /* Volume envelope */
-    decoder->env_time++;
+    if (patch->phaser_on && mixer->pool.free == NULL) {
+        /* Steal the delay line too, if the voice doesn't have one */
+        if (voice->id == 0 || voice->voice.phaser_buffer == NULL) {
+            al_sfxr_MixerVoice* const holder = al_sfxr_mixer_victim(mixer, 1);
 
-    if (decoder->env_time > decoder->env_length[decoder->env_stage]) {
-        decoder->env_time = 0;
-        decoder->env_stage++;
+            if (holder == NULL || holder->priority > priority) {
+                return 0;
+            }
 
-        if (decoder->env_stage == 3) {
-            decoder->playing_sample = 0;
-            return 0.0f;
+            if (voice->id == 0) {
+                al_sfxr_mixer_free(mixer, holder);
+            }
+            else {
+                /* Take the holder's voice instead of stopping two voices */
+                voice = holder;
+            }
         }
     }
 
-    if (decoder->env_stage == 0) {
-        decoder->env_vol = (float)decoder->env_time / decoder->env_length[0];
+    if (voice->id != 0) {
+        al_sfxr_mixer_free(mixer, voice);
     }
-    else if (decoder->env_stage == 1) {
-        decoder->env_vol = 1.0f + pow(1.0f - (float)decoder->env_time / decoder->env_length[1], 1.0f) *
-                           2.0f * decoder->params.p_env_punch;
+
+    voice->patch = *patch;
+
+    if (al_sfxr_voice_start(&voice->voice, &voice->patch, seed, &mixer->pool) != 0) {
+        return 0;
     }
-    else if (decoder->env_stage == 2) {
-        decoder->env_vol = 1.0f - (float)decoder->env_time / decoder->env_length[2];
+
+    if (mixer->mode != 0) {
+        al_sfxr_voice_set_mode(&voice->voice, mixer->mode);
     }
 
-    /* Phaser step */
-    decoder->fphase += decoder->fdphase;
-    decoder->iphase = abs((int)decoder->fphase);
+    voice->gain = gain;
+    voice->priority = priority;
+    voice->id = id;
+    voice->started = mixer->clock++;
+    return id;
+}
 
-    if (decoder->iphase > 1023) {
-        decoder->iphase = 1023;
-    }
+unsigned al_sfxr_mixer_play(al_sfxr_Mixer* const mixer, al_sfxr_Patch const* const patch, uint64_t const seed,
+                            float const gain, int const priority) {
+    return al_sfxr_mixer_start(mixer, al_sfxr_mixer_newid(mixer), patch, seed, gain, priority);
+}
 
-    if (decoder->flthp_d != 0.0f) {
-        decoder->flthp *= decoder->flthp_d;
+void al_sfxr_mixer_set_mode(al_sfxr_Mixer* const mixer, unsigned const mode) {
+    mixer->mode = mode;
 
-        if (decoder->flthp < 0.00001f) {
-            decoder->flthp = 0.00001f;
+    for (unsigned i = 0; i < mixer->num_voices; i++) {
+        if (mixer->voices[i].id != 0) {
+            al_sfxr_voice_set_mode(&mixer->voices[i].voice, mode);
         }
+    }
+}
 
-        if (decoder->flthp > 0.1f) {
-            decoder->flthp = 0.1f;
+static al_sfxr_MixerVoice* al_sfxr_mixer_find(al_sfxr_Mixer* const mixer, unsigned const id) {
+    for (unsigned i = 0; i < mixer->num_voices; i++) {
+        if (id != 0 && mixer->voices[i].id == id) {
+            return mixer->voices + i;
         }
     }
 
-    float ssample = 0.0f;
-
-    /* 8x supersampling */
-    for (int si = 0; si < 8; si++) {
-        float sample = 0.0f;
+    return NULL;
+}
 
-        decoder->phase++;
+void al_sfxr_mixer_stop(al_sfxr_Mixer* const mixer, unsigned const id) {
+    al_sfxr_MixerVoice* const voice = al_sfxr_mixer_find(mixer, id);
 
-        if (decoder->phase >= decoder->period) {
-            decoder->phase %= decoder->period;
+    if (voice != NULL) {
+        al_sfxr_mixer_free(mixer, voice);
+    }
+}
 
-            if (decoder->params.wave_type == AL_SFXR_NOISE) {
-                for (int i = 0; i < 32; i++) {
-                    decoder->noise_buffer[i] = al_sfxr_randf(&decoder->prng, 2.0f) - 1.0f;
-                }
-            }
+void al_sfxr_mixer_stop_all(al_sfxr_Mixer* const mixer) {
+    for (unsigned i = 0; i < mixer->num_voices; i++) {
+        if (mixer->voices[i].id != 0) {
+            al_sfxr_mixer_free(mixer, mixer->voices + i);
         }
+    }
+}
 
-        /* Base waveform */
-        float fp = (float)decoder->phase / decoder->period;
-
-        switch (decoder->params.wave_type) {
-            case AL_SFXR_SQUARE:
-                if (fp < decoder->square_duty) {
-                    sample = 0.5f;
-                }
-                else {
-                    sample = -0.5f;
-                }
-
-                break;
+void al_sfxr_mixer_set_gain(al_sfxr_Mixer* const mixer, unsigned const id, float const gain) {
+    al_sfxr_MixerVoice* const voice = al_sfxr_mixer_find(mixer, id);
 
-            case AL_SFXR_SAWTOOTH:
-                sample = 1.0f - fp * 2.0f;
-                break;
+    if (voice != NULL) {
+        voice->gain = gain;
+    }
+}
 
-            case AL_SFXR_SINEWAVE:
-                sample = (float)sin(fp * 2.0f * 3.14159265358979323846f);
-                break;
+unsigned al_sfxr_mixer_produce(al_sfxr_Mixer* const mixer, float* const frames, size_t const num_frames) {
+    unsigned playing = 0;
 
-            case AL_SFXR_NOISE:
-                sample = decoder->noise_buffer[decoder->phase * 32 / decoder->period];
-                break;
-        }
+    memset((void*)frames, 0, num_frames * sizeof(float));
 
-        /* Low-pass filter */
-        float pp = decoder->fltp;
-        decoder->fltw *= decoder->fltw_d;
+    for (unsigned i = 0; i < mixer->num_voices; i++) {
+        al_sfxr_MixerVoice* const voice = mixer->voices + i;
 
-        if (decoder->fltw < 0.0f) {
-            decoder->fltw = 0.0f;
+        if (voice->id == 0) {
+            continue;
         }
 
-        if (decoder->fltw > 0.1f) {
-            decoder->fltw = 0.1f;
-        }
+        size_t const done = al_sfxr_voice_mix1f(&voice->voice, frames, num_frames, voice->gain, 1);
 
-        if (decoder->params.p_lpf_freq != 1.0f) {
-            decoder->fltdp += (sample - decoder->fltp) * decoder->fltw;
-            decoder->fltdp -= decoder->fltdp * decoder->fltdmp;
+        if (done < num_frames) {
+            al_sfxr_mixer_free(mixer, voice);
         }
         else {
-            decoder->fltp = sample;
-            decoder->fltdp = 0.0f;
+            playing++;
         }
+    }
 
-        decoder->fltp += decoder->fltdp;
+    return playing;
+}
 
-        /* High-pass filter */
-        decoder->fltphp += decoder->fltp - pp;
-        decoder->fltphp -= decoder->fltphp * decoder->flthp;
-        sample = decoder->fltphp;
+void al_sfxr_queue_init(al_sfxr_Queue* const queue, al_sfxr_Mixer* const mixer, al_sfxr_QueueSlot* const slots,
+                        unsigned const num_slots, int const multi_producer) {
+    queue->mixer = mixer;
+    queue->slots = slots;
+    queue->mask = num_slots - 1;
+    queue->multi_producer = multi_producer;
+    queue->tail = 0;
+    queue->head = 0;
+
+    for (unsigned i = 0; i < num_slots; i++) {
+        slots[i].sequence = i;
+    }
+}
 
-        /* Phaser */
-        decoder->phaser_buffer[decoder->ipp & 1023] = sample;
-        sample += decoder->phaser_buffer[(decoder->ipp - decoder->iphase + 1024) & 1023];
-        decoder->ipp = (decoder->ipp + 1) & 1023;
+/* Reserves the slot at the tail of the queue. A slot at position pos is free
+   when its sequence is pos, and holds a command when its sequence is pos + 1.
+   With a single producer the tail is only written here, so there's no retry */
+static al_sfxr_QueueSlot* al_sfxr_queue_reserve(al_sfxr_Queue* const queue, al_sfxr_CommandType const type) {
+    unsigned pos = al_sfxr_atomic_load(&queue->tail);
 
-        /* Final accumulation and envelope application */
-        ssample += sample * decoder->env_vol;
-    }
+    while (1) {
+        al_sfxr_QueueSlot* const slot = queue->slots + (pos & queue->mask);
+        int const diff = (int)(al_sfxr_atomic_load(&slot->sequence) - pos);
 
-    ssample = ssample / 8;
-    ssample *= 2.0f * decoder->params.sound_vol;
+        if (diff < 0) {
+            /* The consumer hasn't released the slot yet, the queue is full */
+            return NULL;
+        }
+        else if (diff == 0) {
+            if (!queue->multi_producer) {
+                al_sfxr_atomic_store(&queue->tail, pos + 1);
+                slot->command.type = type;
+                return slot;
+            }
+            else if (al_sfxr_atomic_cas(&queue->tail, pos, pos + 1)) {
+                slot->command.type = type;
+                return slot;
+            }
+        }
 
-    if (ssample > 1.0f) {
-        ssample = 1.0f;
-    }
-    else if (ssample < -1.0f) {
-        ssample = -1.0f;
+        pos = al_sfxr_atomic_load(&queue->tail);
     }
+}
 
-    return ssample;
+/* Makes a reserved slot visible to the consumer */
+static void al_sfxr_queue_publish(al_sfxr_QueueSlot* const slot) {
+    al_sfxr_atomic_store(&slot->sequence, slot->sequence + 1);
 }
 
-#if defined(AL_SFXR_INT16_MONO)
-size_t al_sfxr_produce1i(al_sfxr_Decoder* const decoder, int16_t* frames, size_t const num_frames) {
-    size_t i = 0;
+unsigned al_sfxr_queue_play(al_sfxr_Queue* const queue, al_sfxr_Patch const* const patch, uint64_t const seed,
+                            float const gain, int const priority) {
+    al_sfxr_QueueSlot* const slot = al_sfxr_queue_reserve(queue, AL_SFXR_COMMAND_PLAY);
 
-    for (; i < num_frames; i++, frames++) {
-        float const samplef = al_sfxr_produce(decoder);
+    if (slot == NULL) {
+        return 0;
+    }
 
-        if (!decoder->playing_sample) {
-            break;
-        }
+    slot->command.id = al_sfxr_mixer_newid(queue->mixer);
+    slot->command.seed = seed;
+    slot->command.gain = gain;
+    slot->command.priority = priority;
+    slot->command.patch = *patch;
+
+    unsigned const id = slot->command.id;
+    al_sfxr_queue_publish(slot);
+    return id;
+}
+
+int al_sfxr_queue_stop(al_sfxr_Queue* const queue, unsigned const id) {
+    al_sfxr_QueueSlot* const slot = al_sfxr_queue_reserve(queue, AL_SFXR_COMMAND_STOP);
 
-        int16_t const sample = (int16_t)(samplef * 32767.0f);
-        *frames = sample;
+    if (slot == NULL) {
+        return -1;
     }
 
-    return i;
+    slot->command.id = id;
+    al_sfxr_queue_publish(slot);
+    return 0;
 }
-#endif /* AL_SFXR_INT16_MONO */
 
-#if defined(AL_SFXR_INT16_STEREO)
-size_t al_sfxr_produce2i(al_sfxr_Decoder* const decoder, int16_t* frames, size_t const num_frames) {
-    size_t i = 0;
+int al_sfxr_queue_stop_all(al_sfxr_Queue* const queue) {
+    al_sfxr_QueueSlot* const slot = al_sfxr_queue_reserve(queue, AL_SFXR_COMMAND_STOP_ALL);
 
-    for (; i < num_frames; i++, frames += 2) {
-        float const samplef = al_sfxr_produce(decoder);
+    if (slot == NULL) {
+        return -1;
+    }
 
-        if (!decoder->playing_sample) {
-            break;
-        }
+    al_sfxr_queue_publish(slot);
+    return 0;
+}
+
+int al_sfxr_queue_set_gain(al_sfxr_Queue* const queue, unsigned const id, float const gain) {
+    al_sfxr_QueueSlot* const slot = al_sfxr_queue_reserve(queue, AL_SFXR_COMMAND_SET_GAIN);
 
-        int16_t const sample = (int16_t)(samplef * 32767.0f);
-        frames[0] = sample;
-        frames[1] = sample;
+    if (slot == NULL) {
+        return -1;
     }
 
-    return i;
+    slot->command.id = id;
+    slot->command.gain = gain;
+    al_sfxr_queue_publish(slot);
+    return 0;
 }
-#endif /* AL_SFXR_INT16_STEREO */
 
-#if defined(AL_SFXR_FLOAT_MONO)
-size_t al_sfxr_produce1f(al_sfxr_Decoder* const decoder, float* frames, size_t const num_frames) {
-    size_t i = 0;
+unsigned al_sfxr_queue_drain(al_sfxr_Queue* const queue) {
+    al_sfxr_Mixer* const mixer = queue->mixer;
+    unsigned count = 0;
 
-    for (; i < num_frames; i++, frames++) {
-        *frames = al_sfxr_produce(decoder);
+    /* Stop after one lap so producers can't keep the audio thread here */
+    for (; count <= queue->mask; count++) {
+        unsigned const pos = queue->head;
+        al_sfxr_QueueSlot* const slot = queue->slots + (pos & queue->mask);
 
-        if (!decoder->playing_sample) {
+        if (al_sfxr_atomic_load(&slot->sequence) != pos + 1) {
             break;
         }
-    }
 
-    return i;
-}
-#endif /* AL_SFXR_FLOAT_MONO */
+        al_sfxr_Command const* const command = &slot->command;
 
-#if defined(AL_SFXR_FLOAT_STEREO)
-size_t al_sfxr_produce2f(al_sfxr_Decoder* const decoder, float* frames, size_t const num_frames) {
-    size_t i = 0;
+        switch (command->type) {
+            case AL_SFXR_COMMAND_PLAY:
+                al_sfxr_mixer_start(mixer, command->id, &command->patch, command->seed, command->gain,
+                                    command->priority);
+                break;
 
-    for (; i < num_frames; i++, frames += 2) {
-        *frames = al_sfxr_produce(decoder);
+            case AL_SFXR_COMMAND_STOP:
+                al_sfxr_mixer_stop(mixer, command->id);
+                break;
 
-        if (!decoder->playing_sample) {
-            break;
+            case AL_SFXR_COMMAND_STOP_ALL:
+                al_sfxr_mixer_stop_all(mixer);
+                break;
+
+            case AL_SFXR_COMMAND_SET_GAIN:
+                al_sfxr_mixer_set_gain(mixer, command->id, command->gain);
+                break;
         }
 
-        frames[1] = *frames;
+        al_sfxr_atomic_store(&slot->sequence, pos + queue->mask + 1);
+        queue->head = pos + 1;
     }
 
-    return i;
+    return count;
 }
-#endif /* AL_SFXR_FLOAT_STEREO */
-
-#endif /* AL_SFXR_INT16_MONO || AL_SFXR_INT16_STEREO ||
-          AL_SFXR_FLOAT_MONO || AL_SFXR_FLOAT_STEREO */
+#endif /* AL_SFXR_MIXER */
 
 #endif /* AL_SFXR_IMPLEMENTATION */
@@ -0,0 +1,2073 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+/*---------------------------------------------------------------------------*/
+/* al_sfxr config and inclusion */
+#define AL_SFXR_IMPLEMENTATION
+#define AL_SFXR_GENERATE
+#define AL_SFXR_LOAD
+#define AL_SFXR_SAVE
+#define AL_SFXR_BANK
+#define AL_SFXR_QUANTIZE
+#define AL_SFXR_INT16_MONO
+#define AL_SFXR_INT16_STEREO
+#define AL_SFXR_FLOAT_MONO
+#define AL_SFXR_FLOAT_STEREO
+#define AL_SFXR_BATCH
+#define AL_SFXR_CACHE
+#define AL_SFXR_MIXER
+#include "../al_sfxr.h"
+/*---------------------------------------------------------------------------*/
+
+#define BENCH_FRAMES 1024
+#define BENCH_TOTAL_FRAMES (44100 * 20)
+#define BENCH_RUNS 5
+#define BENCH_FFT_SIZE 16384
+#define BENCH_SEEDS 32
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Renders BENCH_TOTAL_FRAMES frames of the sound, restarting it every time it
+   ends, and returns the best time per frame in nanoseconds. A kernel of -1
+   uses the kernel selected for the mode. */
+static double time_params(al_sfxr_Params const* const params, int const kernel, unsigned const mode) {
+    static float frames[BENCH_FRAMES];
+    double best = 0.0;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        al_sfxr_Decoder decoder;
+        size_t total = 0;
+        double const t0 = now();
+
+        while (total < BENCH_TOTAL_FRAMES) {
+            al_sfxr_start_quick(&decoder, params);
+            al_sfxr_set_mode(&decoder, mode);
+
+            if (kernel >= 0) {
+                decoder.voice.kernel = kernel;
+            }
+
+            while (total < BENCH_TOTAL_FRAMES) {
+                size_t const produced = al_sfxr_produce_block(&decoder, frames, BENCH_FRAMES);
+                total += produced;
+
+                if (produced < BENCH_FRAMES) {
+                    break;
+                }
+            }
+        }
+
+        double const ns = (now() - t0) * 1e9 / (double)total;
+
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+static void bench_kernels(void) {
+    static struct {char const* name; al_sfxr_Wave wave_type;} const waves[] = {
+        {"square", AL_SFXR_SQUARE},
+        {"sawtooth", AL_SFXR_SAWTOOTH},
+        {"sinewave", AL_SFXR_SINEWAVE},
+        {"noise", AL_SFXR_NOISE}
+    };
+
+    printf("%-10s %-8s %12s %12s %8s\n", "wave", "variant", "generic ns", "kernel ns", "speedup");
+
+    for (size_t i = 0; i < sizeof(waves) / sizeof(waves[0]); i++) {
+        for (int variant = 0; variant < 4; variant++) {
+            al_sfxr_Params params;
+            al_sfxr_generate(&params, AL_SFXR_PICKUP, 0, 1);
+
+            params.wave_type = waves[i].wave_type;
+            params.p_env_sustain = 1.0f;
+            params.p_arp_speed = 0.0f;
+            params.p_lpf_freq = (variant & 1) ? 0.5f : 1.0f;
+            params.p_vib_strength = (variant & 2) ? 0.5f : 0.0f;
+            params.p_vib_speed = (variant & 2) ? 0.5f : 0.0f;
+
+            static char const* const variants[] = {"plain", "lpf", "vib", "lpf+vib"};
+
+            double const generic = time_params(&params, 0, 0);
+            double const kernel = time_params(&params, -1, 0);
+
+            printf("%-10s %-8s %12.2f %12.2f %7.2fx\n", waves[i].name, variants[variant], generic, kernel, generic / kernel);
+        }
+    }
+}
+
+/* Returns the maximum absolute difference between the frames rendered with
+   the exact mode and with the given mode, for the whole sound. */
+static double max_error(al_sfxr_Params const* const params, unsigned const mode) {
+    static float exact[BENCH_FRAMES], approx[BENCH_FRAMES];
+    al_sfxr_Decoder decoder1, decoder2;
+    double max = 0.0;
+
+    al_sfxr_start_quick(&decoder1, params);
+    al_sfxr_start_quick(&decoder2, params);
+    al_sfxr_set_mode(&decoder2, mode);
+
+    for (;;) {
+        size_t const produced1 = al_sfxr_produce_block(&decoder1, exact, BENCH_FRAMES);
+        size_t const produced2 = al_sfxr_produce_block(&decoder2, approx, BENCH_FRAMES);
+        size_t const produced = produced1 < produced2 ? produced1 : produced2;
+
+        for (size_t i = 0; i < produced; i++) {
+            double const error = fabs((double)exact[i] - (double)approx[i]);
+
+            if (error > max) {
+                max = error;
+            }
+        }
+
+        if (produced < BENCH_FRAMES) {
+            return max;
+        }
+    }
+}
+
+/* Renders sine wave blips and pickups, with and without vibrato, using libm
+   and the AL_SFXR_MODE_FAST_TRIG polynomial. */
+static void bench_trig(void) {
+    static struct {char const* name; al_sfxr_Preset preset;} const presets[] = {
+        {"blip", AL_SFXR_BLIP},
+        {"pickup", AL_SFXR_PICKUP}
+    };
+
+    printf("\n%-10s %-8s %12s %12s %8s %10s\n", "preset", "variant", "libm ns", "fast ns", "speedup", "max error");
+
+    for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+        for (int variant = 0; variant < 2; variant++) {
+            al_sfxr_Params params;
+            al_sfxr_generate(&params, presets[i].preset, 0, 1);
+
+            params.wave_type = AL_SFXR_SINEWAVE;
+            params.p_vib_strength = variant ? 0.5f : 0.0f;
+            params.p_vib_speed = variant ? 0.5f : 0.0f;
+
+            double const libm = time_params(&params, -1, 0);
+            double const fast = time_params(&params, -1, AL_SFXR_MODE_FAST_TRIG);
+            double const error = max_error(&params, AL_SFXR_MODE_FAST_TRIG);
+
+            printf(
+                "%-10s %-8s %12.2f %12.2f %7.2fx %10.2g\n",
+                presets[i].name, variant ? "vib" : "plain", libm, fast, libm / fast, error
+            );
+        }
+    }
+}
+
+/* Renders noise explosions and hits, at their own pitch and at a high pitch
+   that refills the noise buffer more often, with the PRNG and with the
+   AL_SFXR_MODE_FAST_NOISE hashes. */
+static void bench_noise(void) {
+    static struct {char const* name; al_sfxr_Preset preset;} const presets[] = {
+        {"explosion", AL_SFXR_EXPLOSION},
+        {"hit", AL_SFXR_HIT}
+    };
+
+    printf("\n%-10s %-8s %12s %12s %8s\n", "preset", "pitch", "prng ns", "fast ns", "speedup");
+
+    for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+        for (int variant = 0; variant < 2; variant++) {
+            al_sfxr_Params params;
+            al_sfxr_generate(&params, presets[i].preset, 0, 1);
+
+            params.wave_type = AL_SFXR_NOISE;
+
+            if (variant) {
+                params.p_base_freq = 1.0f;
+                params.p_freq_ramp = 0.0f;
+            }
+
+            double const prng = time_params(&params, -1, 0);
+            double const fast = time_params(&params, -1, AL_SFXR_MODE_FAST_NOISE);
+
+            printf(
+                "%-10s %-8s %12.2f %12.2f %7.2fx\n",
+                presets[i].name, variant ? "high" : "preset", prng, fast, prng / fast
+            );
+        }
+    }
+}
+
+#define BENCH_TAIL_SLICES 8
+
+/* Renders long explosions whose low-pass cutoff closes during the decay, so
+   the filter state decays through subnormal floats, and adds the time per
+   frame of each slice of the sounds into ns */
+static void time_tail(unsigned const mode, double* const ns) {
+    static float frames[BENCH_FRAMES];
+
+    for (int slice = 0; slice < BENCH_TAIL_SLICES; slice++) {
+        ns[slice] = 0.0;
+    }
+
+    for (uint64_t seed = 1; seed <= 4; seed++) {
+        al_sfxr_Params params;
+        al_sfxr_generate(&params, AL_SFXR_EXPLOSION, 0, seed);
+
+        params.p_env_sustain = 0.3f;
+        params.p_env_decay = 1.0f;
+        params.p_lpf_freq = 0.3f;
+        params.p_lpf_ramp = -1.0f;
+
+        size_t const slice_frames = al_sfxr_length(&params) / BENCH_TAIL_SLICES;
+        double best[BENCH_TAIL_SLICES];
+
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            al_sfxr_Decoder decoder;
+            al_sfxr_start(&decoder, &params, seed);
+            al_sfxr_set_mode(&decoder, mode);
+
+            for (int slice = 0; slice < BENCH_TAIL_SLICES; slice++) {
+                double const t0 = now();
+
+                for (size_t done = 0; done < slice_frames; done += BENCH_FRAMES) {
+                    size_t const count = slice_frames - done < BENCH_FRAMES ? slice_frames - done : BENCH_FRAMES;
+                    al_sfxr_produce_block(&decoder, frames, count);
+                }
+
+                double const slice_ns = (now() - t0) * 1e9 / (double)slice_frames;
+
+                if (run == 0 || slice_ns < best[slice]) {
+                    best[slice] = slice_ns;
+                }
+            }
+        }
+
+        for (int slice = 0; slice < BENCH_TAIL_SLICES; slice++) {
+            ns[slice] += best[slice] / 4.0;
+        }
+    }
+}
+
+/* Prints the cost of each slice of long explosions, without and with
+   AL_SFXR_MODE_FLUSH_DENORMALS */
+static void bench_denormals(void) {
+    double exact[BENCH_TAIL_SLICES], flush[BENCH_TAIL_SLICES];
+
+    time_tail(0, exact);
+    time_tail(AL_SFXR_MODE_FLUSH_DENORMALS, flush);
+
+    printf("\n%-10s %12s %12s %8s\n", "slice", "default ns", "flush ns", "speedup");
+
+    for (int slice = 0; slice < BENCH_TAIL_SLICES; slice++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%d/%d", slice + 1, BENCH_TAIL_SLICES);
+        printf("%-10s %12.2f %12.2f %7.2fx\n", name, exact[slice], flush[slice], exact[slice] / flush[slice]);
+    }
+}
+
+#define BENCH_STARTS 100000
+
+/* Starts BENCH_STARTS explosions from their parameters, and from a patch
+   compiled once. */
+static void bench_start(void) {
+    static al_sfxr_Decoder decoder;
+    static al_sfxr_Voice voice;
+    static al_sfxr_PhaserLine line;
+    al_sfxr_PhaserPool pool;
+    al_sfxr_Params params;
+    al_sfxr_Patch patch;
+    double decoder_ns = 0.0, voice_ns = 0.0;
+
+    al_sfxr_generate(&params, AL_SFXR_EXPLOSION, 0, 1);
+    al_sfxr_compile(&patch, &params);
+    al_sfxr_pool_init(&pool, &line, 1);
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        double t0 = now();
+
+        for (int i = 0; i < BENCH_STARTS; i++) {
+            al_sfxr_start(&decoder, &params, (uint64_t)i);
+        }
+
+        double const ns_decoder = (now() - t0) * 1e9 / BENCH_STARTS;
+        t0 = now();
+
+        for (int i = 0; i < BENCH_STARTS; i++) {
+            al_sfxr_voice_start(&voice, &patch, (uint64_t)i, &pool);
+            al_sfxr_voice_stop(&voice, &pool);
+        }
+
+        double const ns_voice = (now() - t0) * 1e9 / BENCH_STARTS;
+
+        if (run == 0 || ns_decoder < decoder_ns) {
+            decoder_ns = ns_decoder;
+        }
+
+        if (run == 0 || ns_voice < voice_ns) {
+            voice_ns = ns_voice;
+        }
+    }
+
+    printf("\n%-10s %12s %10s\n", "start", "ns/start", "bytes");
+    printf("%-10s %12.2f %10zu\n", "decoder", decoder_ns, sizeof(al_sfxr_Decoder));
+    printf("%-10s %12.2f %10zu\n", "voice", voice_ns, sizeof(al_sfxr_Voice));
+}
+
+#define BENCH_LIBRARY 8000
+
+typedef struct {
+    uint8_t const* data;
+    size_t pos;
+}
+MemReader;
+
+static int mem_reader(void* const userdata, uint8_t* const byte) {
+    MemReader* const reader = (MemReader*)userdata;
+    *byte = reader->data[reader->pos++];
+    return 0;
+}
+
+static int fp_reader(void* const userdata, uint8_t* const byte) {
+    return fread(byte, 1, 1, (FILE*)userdata) != 1;
+}
+
+/* Loads a library of BENCH_LIBRARY sounds saved one after the other, from a
+   file with fread for each byte, from memory with a reader called for each
+   byte, and from memory with al_sfxr_load_mem_batch, and opens a bank with
+   the same sounds and finds each one in it. */
+static void bench_load(void) {
+    static uint8_t library[BENCH_LIBRARY * AL_SFXR_SAVE_SIZE];
+    static al_sfxr_Params params[BENCH_LIBRARY];
+    static uint32_t ids[BENCH_LIBRARY];
+    double stdio_ns = 0.0, reader_ns = 0.0, batch_ns = 0.0, bank_ns = 0.0;
+    size_t size = 0;
+
+    for (int i = 0; i < BENCH_LIBRARY; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "sound%d", i);
+        ids[i] = al_sfxr_bank_hash(name);
+
+        al_sfxr_generate(&params[i], (al_sfxr_Preset)(i % 8), 0, (uint64_t)i + 1);
+        size += al_sfxr_save_mem(&params[i], library + size, sizeof(library) - size);
+    }
+
+    size_t const bank_size = al_sfxr_bank_size(BENCH_LIBRARY);
+    void* const bank_data = malloc(bank_size);
+
+    if (bank_data == NULL || al_sfxr_bank_write(bank_data, bank_size, params, ids, BENCH_LIBRARY) == 0) {
+        fprintf(stderr, "Error writing the bank\n");
+        exit(EXIT_FAILURE);
+    }
+
+    FILE* const fp = tmpfile();
+
+    if (fp == NULL || fwrite(library, 1, size, fp) != size) {
+        fprintf(stderr, "Error writing the library\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        rewind(fp);
+        double t0 = now();
+
+        for (int i = 0; i < BENCH_LIBRARY; i++) {
+            if (al_sfxr_load(&params[i], fp_reader, fp) != 0) {
+                fprintf(stderr, "Error loading the library\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        double const ns_stdio = (now() - t0) * 1e9 / BENCH_LIBRARY;
+        MemReader reader = {library, 0};
+        t0 = now();
+
+        for (int i = 0; i < BENCH_LIBRARY; i++) {
+            if (al_sfxr_load(&params[i], mem_reader, &reader) != 0) {
+                fprintf(stderr, "Error loading the library\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        double const ns_reader = (now() - t0) * 1e9 / BENCH_LIBRARY;
+        t0 = now();
+
+        if (al_sfxr_load_mem_batch(params, BENCH_LIBRARY, library, size, NULL) != BENCH_LIBRARY) {
+            fprintf(stderr, "Error loading the library\n");
+            exit(EXIT_FAILURE);
+        }
+
+        double const ns_batch = (now() - t0) * 1e9 / BENCH_LIBRARY;
+        al_sfxr_Bank bank;
+        uintptr_t found = 0;
+        t0 = now();
+
+        if (al_sfxr_bank_open(&bank, bank_data, bank_size) != 0) {
+            fprintf(stderr, "Error opening the bank\n");
+            exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0; i < BENCH_LIBRARY; i++) {
+            found += (uintptr_t)al_sfxr_bank_find(&bank, ids[i]);
+        }
+
+        double const ns_bank = (now() - t0) * 1e9 / BENCH_LIBRARY;
+
+        if (found == 0) {
+            exit(EXIT_FAILURE);
+        }
+
+        if (run == 0 || ns_stdio < stdio_ns) {
+            stdio_ns = ns_stdio;
+        }
+
+        if (run == 0 || ns_reader < reader_ns) {
+            reader_ns = ns_reader;
+        }
+
+        if (run == 0 || ns_batch < batch_ns) {
+            batch_ns = ns_batch;
+        }
+
+        if (run == 0 || ns_bank < bank_ns) {
+            bank_ns = ns_bank;
+        }
+    }
+
+    fclose(fp);
+    free(bank_data);
+
+    printf("\n%d sounds, %zu bytes, %zu in a bank\n", BENCH_LIBRARY, size, bank_size);
+    printf("%-10s %12s\n", "load", "ns/sound");
+    printf("%-10s %12.2f\n", "stdio", stdio_ns);
+    printf("%-10s %12.2f %7.2fx\n", "reader", reader_ns, stdio_ns / reader_ns);
+    printf("%-10s %12.2f %7.2fx\n", "batch", batch_ns, stdio_ns / batch_ns);
+    printf("%-10s %12.2f %7.2fx\n", "bank", bank_ns, stdio_ns / bank_ns);
+}
+
+/* Opens a seed bank with BENCH_LIBRARY sounds and finds each one in it,
+   generating them the first time and finding them in the memoization table
+   the second time, and generates all of them with al_sfxr_seedbank_generate
+   as a worker thread would. */
+static void bench_seedbank(void) {
+    static al_sfxr_Seed seeds[BENCH_LIBRARY];
+    static uint32_t ids[BENCH_LIBRARY];
+    static al_sfxr_SeedSlot slots[BENCH_LIBRARY];
+    double cold_ns = 0.0, memo_ns = 0.0, worker_ns = 0.0;
+
+    for (int i = 0; i < BENCH_LIBRARY; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "sound%d", i);
+        ids[i] = al_sfxr_bank_hash(name);
+
+        seeds[i].preset = (al_sfxr_Preset)(i % 8);
+        seeds[i].mutations = (unsigned)(i % 4);
+        seeds[i].seed = (uint64_t)i + 1;
+        seeds[i].volume = -1.0f;
+    }
+
+    size_t const size = al_sfxr_seedbank_size(BENCH_LIBRARY);
+    void* const data = malloc(size);
+
+    if (data == NULL || al_sfxr_seedbank_write(data, size, seeds, ids, BENCH_LIBRARY) == 0) {
+        fprintf(stderr, "Error writing the seed bank\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        al_sfxr_SeedBank bank;
+        al_sfxr_Params params;
+        uintptr_t found = 0;
+
+        memset((void*)slots, 0, sizeof(slots));
+        double t0 = now();
+
+        if (al_sfxr_seedbank_open(&bank, data, size) != 0) {
+            fprintf(stderr, "Error opening the seed bank\n");
+            exit(EXIT_FAILURE);
+        }
+
+        al_sfxr_seedbank_memoize(&bank, slots);
+
+        for (int i = 0; i < BENCH_LIBRARY; i++) {
+            found += (uintptr_t)al_sfxr_seedbank_find(&bank, ids[i], &params);
+        }
+
+        double const ns_cold = (now() - t0) * 1e9 / BENCH_LIBRARY;
+        t0 = now();
+
+        for (int i = 0; i < BENCH_LIBRARY; i++) {
+            found += (uintptr_t)al_sfxr_seedbank_find(&bank, ids[i], &params);
+        }
+
+        double const ns_memo = (now() - t0) * 1e9 / BENCH_LIBRARY;
+
+        memset((void*)slots, 0, sizeof(slots));
+        t0 = now();
+        size_t const generated = al_sfxr_seedbank_generate(&bank, 0, BENCH_LIBRARY);
+        double const ns_worker = (now() - t0) * 1e9 / BENCH_LIBRARY;
+
+        if (found == 0 || generated != BENCH_LIBRARY) {
+            exit(EXIT_FAILURE);
+        }
+
+        if (run == 0 || ns_cold < cold_ns) {
+            cold_ns = ns_cold;
+        }
+
+        if (run == 0 || ns_memo < memo_ns) {
+            memo_ns = ns_memo;
+        }
+
+        if (run == 0 || ns_worker < worker_ns) {
+            worker_ns = ns_worker;
+        }
+    }
+
+    free(data);
+
+    printf("\n%d sounds in a seed bank, %zu bytes\n", BENCH_LIBRARY, size);
+    printf("%-10s %12s\n", "seeds", "ns/sound");
+    printf("%-10s %12.2f\n", "first", cold_ns);
+    printf("%-10s %12.2f\n", "memoized", memo_ns);
+    printf("%-10s %12.2f\n", "generate", worker_ns);
+}
+
+#define BENCH_SOUNDS 16
+#define BENCH_TRIGGERS 1000
+
+/* Triggers BENCH_TRIGGERS blips from a set of BENCH_SOUNDS, rendering them
+   every time, and copying them from a cache. */
+static void bench_cache(void) {
+    static float frames[44100 * 4];
+    al_sfxr_Params params[BENCH_SOUNDS];
+    al_sfxr_Cache cache;
+    double render_ns = 0.0, cache_ns = 0.0;
+    size_t total = 0;
+
+    for (int i = 0; i < BENCH_SOUNDS; i++) {
+        al_sfxr_generate(&params[i], AL_SFXR_BLIP, 0, (uint64_t)i + 1);
+    }
+
+    al_sfxr_cache_init(&cache, (size_t)64 << 20);
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        double t0 = now();
+        total = 0;
+
+        for (int i = 0; i < BENCH_TRIGGERS; i++) {
+            al_sfxr_Decoder decoder;
+            al_sfxr_start(&decoder, &params[i % BENCH_SOUNDS], 1);
+            total += al_sfxr_produce_block(&decoder, frames, sizeof(frames) / sizeof(frames[0]));
+        }
+
+        double const ns_render = (now() - t0) * 1e9 / (double)total;
+        t0 = now();
+
+        for (int i = 0; i < BENCH_TRIGGERS; i++) {
+            al_sfxr_CacheEntry const* const entry = al_sfxr_cache_acquire(&cache, &params[i % BENCH_SOUNDS], 1);
+            memcpy((void*)frames, (void const*)entry->frames, entry->num_frames * sizeof(float));
+            al_sfxr_cache_release(&cache, entry);
+        }
+
+        double const ns_cache = (now() - t0) * 1e9 / (double)total;
+
+        if (run == 0 || ns_render < render_ns) {
+            render_ns = ns_render;
+        }
+
+        if (run == 0 || ns_cache < cache_ns) {
+            cache_ns = ns_cache;
+        }
+    }
+
+    printf("\n%d triggers of %d blips, %zu frames\n", BENCH_TRIGGERS, BENCH_SOUNDS, total);
+    printf("%-10s %12s\n", "source", "ns/frame");
+    printf("%-10s %12.2f\n", "render", render_ns);
+    printf("%-10s %12.2f %7.2fx\n", "cache", cache_ns, render_ns / cache_ns);
+    printf(
+        "hits %llu, misses %llu, evictions %llu, %zu bytes\n",
+        (unsigned long long)cache.hits, (unsigned long long)cache.misses, (unsigned long long)cache.evictions,
+        cache.bytes
+    );
+
+    al_sfxr_cache_destroy(&cache);
+}
+
+#define BENCH_VOICES 64
+#define BENCH_BATCHES (BENCH_VOICES / AL_SFXR_BATCH_LANES)
+
+/* Renders BENCH_VOICES explosions at the same time, restarting each one when
+   it ends, with individual decoders and with decoder batches. */
+static void bench_batch(void) {
+    static float frames[BENCH_FRAMES], mix[BENCH_FRAMES];
+    static al_sfxr_Params params[BENCH_VOICES];
+    static al_sfxr_Decoder decoders[BENCH_VOICES];
+    static al_sfxr_DecoderBatch batches[BENCH_BATCHES];
+
+    for (int i = 0; i < BENCH_VOICES; i++) {
+        al_sfxr_generate(&params[i], AL_SFXR_EXPLOSION, 0, (uint64_t)i + 1);
+    }
+
+    size_t const blocks = BENCH_TOTAL_FRAMES / BENCH_FRAMES / 4;
+    double scalar = 0.0, batch = 0.0;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        for (int i = 0; i < BENCH_VOICES; i++) {
+            al_sfxr_start(&decoders[i], &params[i], (uint64_t)i);
+        }
+
+        double t0 = now();
+
+        for (size_t b = 0; b < blocks; b++) {
+            memset((void*)mix, 0, sizeof(mix));
+
+            for (int i = 0; i < BENCH_VOICES; i++) {
+                size_t const produced = al_sfxr_produce_block(&decoders[i], frames, BENCH_FRAMES);
+
+                for (size_t j = 0; j < produced; j++) {
+                    mix[j] += frames[j];
+                }
+
+                if (produced < BENCH_FRAMES) {
+                    al_sfxr_start(&decoders[i], &params[i], (uint64_t)i);
+                }
+            }
+        }
+
+        double const ns_scalar = (now() - t0) * 1e9 / (double)(blocks * BENCH_FRAMES * BENCH_VOICES);
+
+        for (int i = 0; i < BENCH_BATCHES; i++) {
+            al_sfxr_batch_init(&batches[i]);
+
+            for (unsigned l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+                int const v = i * AL_SFXR_BATCH_LANES + (int)l;
+                al_sfxr_batch_start(&batches[i], l, &params[v], (uint64_t)v);
+            }
+        }
+
+        t0 = now();
+
+        for (size_t b = 0; b < blocks; b++) {
+            memset((void*)mix, 0, sizeof(mix));
+
+            for (int i = 0; i < BENCH_BATCHES; i++) {
+                unsigned const playing = al_sfxr_batch_produce(&batches[i], frames, BENCH_FRAMES);
+
+                for (size_t j = 0; j < BENCH_FRAMES; j++) {
+                    mix[j] += frames[j];
+                }
+
+                for (unsigned l = 0; l < AL_SFXR_BATCH_LANES; l++) {
+                    if ((playing & (1u << l)) == 0) {
+                        int const v = i * AL_SFXR_BATCH_LANES + (int)l;
+                        al_sfxr_batch_start(&batches[i], l, &params[v], (uint64_t)v);
+                    }
+                }
+            }
+        }
+
+        double const ns_batch = (now() - t0) * 1e9 / (double)(blocks * BENCH_FRAMES * BENCH_VOICES);
+
+        if (run == 0 || ns_scalar < scalar) {
+            scalar = ns_scalar;
+        }
+
+        if (run == 0 || ns_batch < batch) {
+            batch = ns_batch;
+        }
+    }
+
+    printf("\n%d explosion voices, %d lanes per batch\n", BENCH_VOICES, AL_SFXR_BATCH_LANES);
+    printf("%-10s %12s\n", "renderer", "ns/voice");
+    printf("%-10s %12.2f\n", "decoders", scalar);
+    printf("%-10s %12.2f %7.2fx\n", "batches", batch, scalar / batch);
+}
+
+/* Plays BENCH_VOICES explosions at the same time in a mixer, restarting them
+   when they end. */
+static void bench_mixer(void) {
+    static float frames[BENCH_FRAMES];
+    static al_sfxr_MixerVoice voices[BENCH_VOICES];
+    static al_sfxr_PhaserLine lines[BENCH_VOICES];
+    static al_sfxr_Patch patches[BENCH_VOICES];
+    al_sfxr_Mixer mixer;
+    double best = 0.0;
+
+    for (int i = 0; i < BENCH_VOICES; i++) {
+        al_sfxr_Params params;
+        al_sfxr_generate(&params, AL_SFXR_EXPLOSION, 0, (uint64_t)i + 1);
+        al_sfxr_compile(&patches[i], &params);
+    }
+
+    size_t const blocks = BENCH_TOTAL_FRAMES / BENCH_FRAMES / 4;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        al_sfxr_mixer_init(&mixer, voices, BENCH_VOICES, lines, BENCH_VOICES);
+        size_t voice_frames = 0;
+        unsigned playing = 0;
+        double const t0 = now();
+
+        for (size_t b = 0; b < blocks; b++) {
+            for (; playing < BENCH_VOICES; playing++) {
+                al_sfxr_mixer_play(&mixer, &patches[playing], playing, 1.0f / BENCH_VOICES, 0);
+            }
+
+            playing = al_sfxr_mixer_produce(&mixer, frames, BENCH_FRAMES);
+            voice_frames += BENCH_FRAMES * BENCH_VOICES;
+        }
+
+        double const ns = (now() - t0) * 1e9 / (double)voice_frames;
+
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    printf("\n%d explosion voices in a mixer\n", BENCH_VOICES);
+    printf("%-10s %12s\n", "renderer", "ns/voice");
+    printf("%-10s %12.2f\n", "mixer", best);
+}
+
+/* Mixes BENCH_VOICES explosions into a mono and a stereo bus, restarting them
+   when they end, by producing each one into a scratch buffer and adding it
+   to the bus, and by adding it directly with al_sfxr_mix1f and
+   al_sfxr_mix2f. */
+static double time_mix(int const method) {
+    static float scratch[BENCH_FRAMES], bus[BENCH_FRAMES * 2];
+    static al_sfxr_Params params[BENCH_VOICES];
+    static al_sfxr_Decoder decoders[BENCH_VOICES];
+    float const gain = 1.0f / BENCH_VOICES;
+    double best = 0.0;
+
+    for (int i = 0; i < BENCH_VOICES; i++) {
+        al_sfxr_generate(&params[i], AL_SFXR_EXPLOSION, 0, (uint64_t)i + 1);
+    }
+
+    size_t const blocks = BENCH_TOTAL_FRAMES / BENCH_FRAMES / 4;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        for (int i = 0; i < BENCH_VOICES; i++) {
+            al_sfxr_start(&decoders[i], &params[i], (uint64_t)i);
+        }
+
+        double const t0 = now();
+
+        for (size_t b = 0; b < blocks; b++) {
+            memset((void*)bus, 0, sizeof(bus));
+
+            for (int i = 0; i < BENCH_VOICES; i++) {
+                float const pan = (float)(i % 9 - 4) / 4.0f;
+                size_t produced = 0;
+
+                switch (method) {
+                    case 0:
+                        produced = al_sfxr_produce1f(&decoders[i], scratch, BENCH_FRAMES);
+
+                        for (size_t j = 0; j < produced; j++) {
+                            bus[j] += scratch[j] * gain;
+                        }
+
+                        break;
+
+                    case 1: produced = al_sfxr_mix1f(&decoders[i], bus, BENCH_FRAMES, gain, 1); break;
+                    case 2: produced = al_sfxr_mix1f(&decoders[i], bus, BENCH_FRAMES, gain, 0); break;
+
+                    case 3: {
+                        float const left = gain * sqrtf((1.0f - pan) * 0.5f);
+                        float const right = gain * sqrtf((1.0f + pan) * 0.5f);
+                        produced = al_sfxr_produce1f(&decoders[i], scratch, BENCH_FRAMES);
+
+                        for (size_t j = 0; j < produced; j++) {
+                            bus[j * 2] += scratch[j] * left;
+                            bus[j * 2 + 1] += scratch[j] * right;
+                        }
+
+                        break;
+                    }
+
+                    case 4: produced = al_sfxr_mix2f(&decoders[i], bus, BENCH_FRAMES, gain, pan, 1); break;
+                }
+
+                if (produced < BENCH_FRAMES) {
+                    al_sfxr_start(&decoders[i], &params[i], (uint64_t)i);
+                }
+            }
+        }
+
+        double const ns = (now() - t0) * 1e9 / (double)(blocks * BENCH_FRAMES * BENCH_VOICES);
+
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+static void bench_mix(void) {
+    static char const* const names[] = {"scratch1f", "mix1f", "mix1f raw", "scratch2f", "mix2f"};
+
+    printf("\n%d explosion voices mixed into a bus\n", BENCH_VOICES);
+    printf("%-10s %12s\n", "renderer", "ns/voice");
+
+    for (int method = 0; method < 5; method++) {
+        printf("%-10s %12.2f\n", names[method], time_mix(method));
+    }
+}
+
+/* Renders every preset with a few seeds at the given oversampling factor and
+   mode, and returns the best time per frame in nanoseconds */
+static double time_oversampling(unsigned const oversampling, unsigned const mode) {
+    static float frames[BENCH_FRAMES];
+    double best = 0.0;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        size_t total = 0;
+        double const t0 = now();
+
+        for (int preset = AL_SFXR_PICKUP; preset <= AL_SFXR_BLIP; preset++) {
+            for (uint64_t seed = 1; seed <= 4; seed++) {
+                al_sfxr_Params params;
+                al_sfxr_generate(&params, (al_sfxr_Preset)preset, 0, seed);
+
+                al_sfxr_Decoder decoder;
+                al_sfxr_start_ex(&decoder, &params, seed, 44100, oversampling);
+                al_sfxr_set_mode(&decoder, mode);
+
+                for (;;) {
+                    size_t const produced = al_sfxr_produce_block(&decoder, frames, BENCH_FRAMES);
+                    total += produced;
+
+                    if (produced < BENCH_FRAMES) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        double const ns = (now() - t0) * 1e9 / (double)total;
+
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+/* In-place radix-2 FFT of BENCH_FFT_SIZE complex values */
+static void fft(double* const re, double* const im) {
+    size_t const n = BENCH_FFT_SIZE;
+
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+
+        j ^= bit;
+
+        if (i < j) {
+            double const tr = re[i], ti = im[i];
+            re[i] = re[j], im[i] = im[j];
+            re[j] = tr, im[j] = ti;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double const angle = -2.0 * 3.14159265358979323846 / (double)len;
+
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t j = 0; j < len / 2; j++) {
+                double const wr = cos(angle * (double)j), wi = sin(angle * (double)j);
+                double const ur = re[i + j], ui = im[i + j];
+                double const vr = re[i + j + len / 2] * wr - im[i + j + len / 2] * wi;
+                double const vi = re[i + j + len / 2] * wi + im[i + j + len / 2] * wr;
+
+                re[i + j] = ur + vr, im[i + j] = ui + vi;
+                re[i + j + len / 2] = ur - vr, im[i + j + len / 2] = ui - vi;
+            }
+        }
+    }
+}
+
+/* Renders a steady tone and returns the power of everything that isn't a
+   harmonic of the tone, relative to the power of the harmonics, in dB.
+   Harmonics above the Nyquist frequency fold back between the harmonics
+   below it, so this is the aliasing. When the period is a whole number of
+   frames, as it always is at 1x, they fold back onto the harmonics and
+   change the timbre instead, which this doesn't measure, so the tones used
+   have periods of 277 and 125 sub-samples at 8x, which aren't whole numbers
+   of frames at 2x, 4x, and 8x. Band-limited tones keep the fraction of their
+   period, so they can be measured at 1x too. */
+static double aliasing(al_sfxr_Wave const wave_type, float const base_freq, unsigned const oversampling,
+                       unsigned const mode) {
+    static float frames[BENCH_FFT_SIZE];
+    static double re[BENCH_FFT_SIZE], im[BENCH_FFT_SIZE];
+
+    al_sfxr_Params params;
+    memset(&params, 0, sizeof(params));
+    params.wave_type = wave_type;
+    params.p_base_freq = base_freq;
+    params.p_env_sustain = 1.0f;
+    params.p_lpf_freq = 1.0f;
+    params.sound_vol = 0.1f;
+
+    al_sfxr_Decoder decoder;
+    al_sfxr_start_ex(&decoder, &params, 1, 44100, oversampling);
+    al_sfxr_set_mode(&decoder, mode);
+
+    /* Skip the start of the sound */
+    al_sfxr_produce_block(&decoder, frames, BENCH_FFT_SIZE);
+    al_sfxr_produce_block(&decoder, frames, BENCH_FFT_SIZE);
+
+    for (size_t i = 0; i < BENCH_FFT_SIZE; i++) {
+        double const hann = 0.5 - 0.5 * cos(2.0 * 3.14159265358979323846 * (double)i / BENCH_FFT_SIZE);
+        re[i] = frames[i] * hann;
+        im[i] = 0.0;
+    }
+
+    fft(re, im);
+
+    /* The period of the tone is in sub-samples, or in steps of a sub-sample */
+    double const period = (double)decoder.voice.period / (mode & AL_SFXR_MODE_BANDLIMITED ? AL_SFXR_BLEP_STEPS : 1);
+    double const bins_per_harmonic = (double)BENCH_FFT_SIZE * oversampling / period;
+    double const harmonic = 1.0 / bins_per_harmonic;
+    double signal = 0.0, alias = 0.0;
+
+    for (size_t i = 4; i < BENCH_FFT_SIZE / 2; i++) {
+        double const power = re[i] * re[i] + im[i] * im[i];
+        double const h = (double)i * harmonic;
+
+        if (fabs(h - floor(h + 0.5)) * bins_per_harmonic <= 3.0) {
+            signal += power;
+        }
+        else {
+            alias += power;
+        }
+    }
+
+    return 10.0 * log10(alias / signal);
+}
+
+/* Returns how far the pitch of a tone is from the exact one because the
+   period is a whole number of sub-samples, or of steps of a sub-sample, in
+   cents */
+static double pitch_error(float const base_freq, unsigned const oversampling, unsigned const mode) {
+    static float frames[1];
+
+    al_sfxr_Params params;
+    memset(&params, 0, sizeof(params));
+    params.p_base_freq = base_freq;
+    params.p_env_sustain = 1.0f;
+
+    al_sfxr_Decoder decoder;
+    al_sfxr_start_ex(&decoder, &params, 1, 44100, oversampling);
+    al_sfxr_set_mode(&decoder, mode);
+    al_sfxr_produce_block(&decoder, frames, 1);
+
+    double const period = (double)decoder.voice.period / (mode & AL_SFXR_MODE_BANDLIMITED ? AL_SFXR_BLEP_STEPS : 1);
+    return 1200.0 * log2(decoder.patch.fperiod / period);
+}
+
+static void bench_oversampling(void) {
+    static unsigned const factors[] = {8, 4, 2, 1};
+    static unsigned const modes[] = {0, AL_SFXR_MODE_BANDLIMITED};
+    double const ns8 = time_oversampling(8, 0);
+
+    printf("\n%-12s %10s %8s %13s %13s %13s %10s\n", "oversampling", "ns", "speedup", "square 2.8k", "saw 1.3k",
+           "saw 2.8k", "2.8k cents");
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        unsigned const mode = modes[m];
+
+        for (size_t i = 0; i < sizeof(factors) / sizeof(factors[0]); i++) {
+            unsigned const factor = factors[i];
+            double const ns = mode == 0 && factor == 8 ? ns8 : time_oversampling(factor, mode);
+
+            printf("%6ux %-5s %10.2f %7.2fx", factor, mode == 0 ? "" : "blep", ns, ns8 / ns);
+
+            if (factor == 1 && mode == 0) {
+                printf(" %13s %13s %13s", "n/a", "n/a", "n/a");
+            }
+            else {
+                printf(" %10.1f dB %10.1f dB %10.1f dB",
+                       aliasing(AL_SFXR_SQUARE, 0.892f, factor, mode),
+                       aliasing(AL_SFXR_SAWTOOTH, 0.6f, factor, mode),
+                       aliasing(AL_SFXR_SAWTOOTH, 0.892f, factor, mode));
+            }
+
+            printf(" %10.1f\n", pitch_error(0.892f, factor, mode));
+        }
+    }
+}
+
+static size_t produce1i(al_sfxr_Decoder* const decoder, void* const frames, size_t const num_frames) {
+    return al_sfxr_produce1i(decoder, (int16_t*)frames, num_frames);
+}
+
+static size_t produce2i(al_sfxr_Decoder* const decoder, void* const frames, size_t const num_frames) {
+    return al_sfxr_produce2i(decoder, (int16_t*)frames, num_frames);
+}
+
+static size_t produce1f(al_sfxr_Decoder* const decoder, void* const frames, size_t const num_frames) {
+    return al_sfxr_produce1f(decoder, (float*)frames, num_frames);
+}
+
+static size_t produce2f(al_sfxr_Decoder* const decoder, void* const frames, size_t const num_frames) {
+    return al_sfxr_produce2f(decoder, (float*)frames, num_frames);
+}
+
+typedef size_t (*Produce)(al_sfxr_Decoder* const, void* const, size_t const);
+
+static struct {char const* name; Produce produce;} const s_formats[] = {
+    {"produce1i", produce1i},
+    {"produce2i", produce2i},
+    {"produce1f", produce1f},
+    {"produce2f", produce2f}
+};
+
+#define BENCH_FORMATS (sizeof(s_formats) / sizeof(s_formats[0]))
+
+static char const* const s_preset_names[] = {
+    "random", "pickup", "laser", "explosion", "powerup", "hit", "jump", "blip"
+};
+
+#define BENCH_PRESETS (sizeof(s_preset_names) / sizeof(s_preset_names[0]))
+
+static unsigned const s_callbacks[] = {256, 512};
+
+#define BENCH_CALLBACKS (sizeof(s_callbacks) / sizeof(s_callbacks[0]))
+
+typedef struct {
+    size_t frames[BENCH_PRESETS];
+    double ns[BENCH_PRESETS][BENCH_FORMATS];
+    double callback_ns[BENCH_FORMATS][BENCH_CALLBACKS];
+}
+Sweep;
+
+/* Renders BENCH_SEEDS sounds of a preset with a format, in calls of
+   block_size frames, and returns the best time per frame in nanoseconds */
+static double time_preset(al_sfxr_Params const* const params, Produce const produce, size_t const block_size,
+                          size_t* const frames) {
+    static float buffer[BENCH_FRAMES * 2];
+    double best = 0.0;
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        size_t total = 0;
+        double const t0 = now();
+
+        for (int seed = 0; seed < BENCH_SEEDS; seed++) {
+            al_sfxr_Decoder decoder;
+            al_sfxr_start(&decoder, params + seed, (uint64_t)seed);
+
+            for (;;) {
+                size_t const produced = produce(&decoder, buffer, block_size);
+                total += produced;
+
+                if (produced < block_size) {
+                    break;
+                }
+            }
+        }
+
+        double const ns = (now() - t0) * 1e9 / (double)total;
+
+        if (run == 0 || ns < best) {
+            best = ns;
+        }
+
+        *frames = total;
+    }
+
+    return best;
+}
+
+/* Renders every preset with BENCH_SEEDS seeds in every format, in blocks of
+   BENCH_FRAMES frames and in blocks of the callback sizes */
+static void sweep(Sweep* const result) {
+    static al_sfxr_Params params[BENCH_PRESETS][BENCH_SEEDS];
+
+    for (size_t p = 0; p < BENCH_PRESETS; p++) {
+        for (int seed = 0; seed < BENCH_SEEDS; seed++) {
+            al_sfxr_generate(&params[p][seed], (al_sfxr_Preset)p, 0, (uint64_t)seed);
+        }
+    }
+
+    for (size_t f = 0; f < BENCH_FORMATS; f++) {
+        for (size_t p = 0; p < BENCH_PRESETS; p++) {
+            result->ns[p][f] = time_preset(params[p], s_formats[f].produce, BENCH_FRAMES, &result->frames[p]);
+        }
+
+        /* The time of a callback is the sum over the presets, which all
+           render the same number of sounds */
+        for (size_t c = 0; c < BENCH_CALLBACKS; c++) {
+            double ns = 0.0;
+            size_t total = 0;
+
+            for (size_t p = 0; p < BENCH_PRESETS; p++) {
+                size_t frames = 0;
+                ns += time_preset(params[p], s_formats[f].produce, s_callbacks[c], &frames) * (double)frames;
+                total += frames;
+            }
+
+            result->callback_ns[f][c] = ns / (double)total;
+        }
+    }
+}
+
+/* Returns how many voices a core can render in real time at 44100 Hz */
+static double voices_per_core(double const ns_per_frame) {
+    return 1e9 / (ns_per_frame * 44100.0);
+}
+
+static void bench_sweep(Sweep const* const result) {
+    printf("\n%-10s", "preset");
+
+    for (size_t f = 0; f < BENCH_FORMATS; f++) {
+        printf(" %12s", s_formats[f].name);
+    }
+
+    printf("\n");
+
+    for (size_t p = 0; p < BENCH_PRESETS; p++) {
+        printf("%-10s", s_preset_names[p]);
+
+        for (size_t f = 0; f < BENCH_FORMATS; f++) {
+            printf(" %9.2f ns", result->ns[p][f]);
+        }
+
+        printf("\n");
+    }
+
+    for (size_t c = 0; c < BENCH_CALLBACKS; c++) {
+        char name[16];
+        snprintf(name, sizeof(name), "voices@%u", s_callbacks[c]);
+        printf("%-10s", name);
+
+        for (size_t f = 0; f < BENCH_FORMATS; f++) {
+            printf(" %12.0f", voices_per_core(result->callback_ns[f][c]));
+        }
+
+        printf("\n");
+    }
+}
+
+static void write_json(FILE* const fp, Sweep const* const result) {
+    fprintf(fp, "{\n  \"sample_rate\": 44100,\n  \"seeds\": %d,\n  \"presets\": {\n", BENCH_SEEDS);
+
+    for (size_t p = 0; p < BENCH_PRESETS; p++) {
+        fprintf(fp, "    \"%s\": {\n      \"frames\": %zu", s_preset_names[p], result->frames[p]);
+
+        for (size_t f = 0; f < BENCH_FORMATS; f++) {
+            double const ns = result->ns[p][f];
+            fprintf(fp, ",\n      \"%s\": {\"ns_per_frame\": %.3f, \"frames_per_sec\": %.0f}", s_formats[f].name, ns, 1e9 / ns);
+        }
+
+        fprintf(fp, "\n    }%s\n", p + 1 < BENCH_PRESETS ? "," : "");
+    }
+
+    fprintf(fp, "  },\n  \"voices_per_core\": {\n");
+
+    for (size_t f = 0; f < BENCH_FORMATS; f++) {
+        fprintf(fp, "    \"%s\": {", s_formats[f].name);
+
+        for (size_t c = 0; c < BENCH_CALLBACKS; c++) {
+            fprintf(fp, "%s\"%u\": %.1f", c > 0 ? ", " : "", s_callbacks[c], voices_per_core(result->callback_ns[f][c]));
+        }
+
+        fprintf(fp, "}%s\n", f + 1 < BENCH_FORMATS ? "," : "");
+    }
+
+    fprintf(fp, "  }\n}\n");
+}
+
+#if defined(AL_SFXR_PROFILE)
+/* Renders every preset with BENCH_SEEDS seeds and prints the counters per
+   sound and the share of the time spent in each stage */
+static void bench_profile(void) {
+    static float frames[BENCH_FRAMES];
+    static char const* const stages[AL_SFXR_STAGE_COUNT] = {"frame", "osc", "lpf", "hpf", "phaser", "output"};
+
+    printf("\n%-10s %9s %8s %8s %8s", "preset", "frames", "refills", "repeats", "limits");
+
+    for (int stage = 0; stage < AL_SFXR_STAGE_COUNT; stage++) {
+        printf(" %7s", stages[stage]);
+    }
+
+    printf("\n");
+
+    for (size_t p = 0; p < BENCH_PRESETS; p++) {
+        al_sfxr_Profile total;
+        memset(&total, 0, sizeof(total));
+
+        for (int seed = 0; seed < BENCH_SEEDS; seed++) {
+            al_sfxr_Params params;
+            al_sfxr_generate(&params, (al_sfxr_Preset)p, 0, (uint64_t)seed);
+
+            al_sfxr_Decoder decoder;
+            al_sfxr_start(&decoder, &params, (uint64_t)seed);
+
+            while (al_sfxr_produce_block(&decoder, frames, BENCH_FRAMES) == BENCH_FRAMES) {
+                /* Render the whole sound */
+            }
+
+            al_sfxr_Profile profile;
+            al_sfxr_get_profile(&decoder, &profile);
+
+            total.frames += profile.frames;
+            total.noise_refills += profile.noise_refills;
+            total.repeats += profile.repeats;
+            total.frequency_limits += profile.frequency_limits;
+
+            for (int stage = 0; stage < AL_SFXR_STAGE_COUNT; stage++) {
+                total.cycles[stage] += profile.cycles[stage];
+            }
+        }
+
+        uint64_t cycles = 0;
+
+        for (int stage = 0; stage < AL_SFXR_STAGE_COUNT; stage++) {
+            cycles += total.cycles[stage];
+        }
+
+        printf("%-10s %9.0f %8.1f %8.2f %8.2f", s_preset_names[p], (double)total.frames / BENCH_SEEDS,
+               (double)total.noise_refills / BENCH_SEEDS, (double)total.repeats / BENCH_SEEDS,
+               (double)total.frequency_limits / BENCH_SEEDS);
+
+        for (int stage = 0; stage < AL_SFXR_STAGE_COUNT; stage++) {
+            printf(" %6.1f%%", cycles != 0 ? 100.0 * (double)total.cycles[stage] / (double)cycles : 0.0);
+        }
+
+        printf("\n");
+    }
+}
+#endif /* AL_SFXR_PROFILE */
+
+#define VERIFY_SEEDS 8
+#define VERIFY_MUTATIONS 2
+
+/* Maximum absolute difference per sample from the exact output for the
+   approximate modes. Vibrato is off, because a different vibrato period can
+   move a wave cycle by a whole sample, see bench_trig. */
+#define VERIFY_FAST_TRIG_TOLERANCE 1e-4
+#define VERIFY_FLUSH_TOLERANCE 1e-6
+
+/* The hashes of a sound in the reference file. The default mode and the
+   int16 formats must render the exact output of sfxr, the other modes must
+   render the same output for the same build. */
+typedef struct {
+    uint64_t exact;
+    uint64_t int16;
+    uint64_t fast_noise;
+    uint64_t bandlimited;
+}
+Hashes;
+
+static uint64_t fnv1a(void const* const data, size_t const size, uint64_t hash) {
+    uint8_t const* const bytes = (uint8_t const*)data;
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * UINT64_C(0x100000001b3);
+    }
+
+    return hash;
+}
+
+#define FNV_OFFSET UINT64_C(0xcbf29ce484222325)
+
+/* Renders a whole sound with a decoder in the mode, using the selected kernel
+   or the generic one, and returns the number of frames */
+static size_t render(al_sfxr_Params const* const params, uint64_t const seed, unsigned const mode, int const generic,
+                     float* const frames, size_t const max_frames) {
+    al_sfxr_Decoder decoder;
+    al_sfxr_start(&decoder, params, seed);
+    al_sfxr_set_mode(&decoder, mode);
+
+    if (generic) {
+        decoder.voice.kernel = 0;
+    }
+
+    return al_sfxr_produce_block(&decoder, frames, max_frames);
+}
+
+/* Compares two renders, NaNs compare equal to NaNs and zeros to zeros of
+   either sign, and returns the maximum absolute difference, or -1 if the
+   lengths differ */
+static double compare(float const* const a, size_t const a_frames, float const* const b, size_t const b_frames) {
+    double max = 0.0;
+
+    if (a_frames != b_frames) {
+        return -1.0;
+    }
+
+    for (size_t i = 0; i < a_frames; i++) {
+        if (a[i] == b[i] || (a[i] != a[i] && b[i] != b[i])) {
+            continue;
+        }
+
+        double const error = fabs((double)a[i] - (double)b[i]);
+
+        if (error != error) {
+            /* Only one of them is a NaN */
+            return INFINITY;
+        }
+
+        if (error > max) {
+            max = error;
+        }
+    }
+
+    return max;
+}
+
+#define BENCH_ENVELOPE_FRAMES 441
+
+/* Level of the window of a render that starts at the frame in dB, down to
+   -60 dB, ignoring NaNs */
+static double level(float const* const frames, size_t const num_frames, size_t const start) {
+    size_t const end = num_frames - start < BENCH_ENVELOPE_FRAMES ? num_frames : start + BENCH_ENVELOPE_FRAMES;
+    double power = 0.0;
+
+    for (size_t i = start; i < end; i++) {
+        power += frames[i] == frames[i] ? (double)frames[i] * frames[i] : 0.0;
+    }
+
+    double const rms = sqrt(power / BENCH_ENVELOPE_FRAMES);
+    return 20.0 * log10(rms > 1e-3 ? rms : 1e-3);
+}
+
+/* Mean difference of the levels of two renders in 10 ms windows, in dB, with
+   the frames past the end of the shorter one as silence. Unlike comparing
+   the frames, it doesn't grow when a small change of pitch moves the wave
+   cycles. */
+static double envelope_error(float const* const a, size_t const a_frames, float const* const b,
+                             size_t const b_frames) {
+    size_t const frames = a_frames > b_frames ? a_frames : b_frames;
+    double error = 0.0;
+    size_t windows = 0;
+
+    for (size_t i = 0; i < frames; i += BENCH_ENVELOPE_FRAMES, windows++) {
+        double const a_level = i < a_frames ? level(a, a_frames, i) : -60.0;
+        double const b_level = i < b_frames ? level(b, b_frames, i) : -60.0;
+        error += fabs(a_level - b_level);
+    }
+
+    return windows == 0 ? 0.0 : error / (double)windows;
+}
+
+/* Quantizes BENCH_LIBRARY sounds to 8 and 16 bits per field and restores
+   them, and prints the time per sound. Then renders every preset with
+   BENCH_SEEDS seeds from the original and the restored parameters, and
+   prints how much they differ: how many render the same frames, and the
+   largest difference of the starting pitch in cents, of the length in
+   milliseconds, and of the envelope in dB. */
+static void bench_quantize(void) {
+    static al_sfxr_Params params[BENCH_LIBRARY];
+    static al_sfxr_Params restored[BENCH_LIBRARY];
+    static al_sfxr_Params8 packed8[BENCH_LIBRARY];
+    static al_sfxr_Params16 packed16[BENCH_LIBRARY];
+    double ns[4] = {0.0, 0.0, 0.0, 0.0};
+
+    for (int i = 0; i < BENCH_LIBRARY; i++) {
+        al_sfxr_generate(params + i, (al_sfxr_Preset)(i % 8), (unsigned)(i % 4), (uint64_t)i + 1);
+    }
+
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        double t[5];
+
+        t[0] = now();
+        al_sfxr_pack8(packed8, params, BENCH_LIBRARY);
+        t[1] = now();
+        al_sfxr_unpack8(restored, packed8, BENCH_LIBRARY);
+        t[2] = now();
+        al_sfxr_pack16(packed16, params, BENCH_LIBRARY);
+        t[3] = now();
+        al_sfxr_unpack16(restored, packed16, BENCH_LIBRARY);
+        t[4] = now();
+
+        for (int i = 0; i < 4; i++) {
+            double const run_ns = (t[i + 1] - t[i]) * 1e9 / BENCH_LIBRARY;
+
+            if (run == 0 || run_ns < ns[i]) {
+                ns[i] = run_ns;
+            }
+        }
+    }
+
+    printf("\n%d sounds, %zu bytes, %zu quantized to 8 bits, %zu to 16 bits\n", BENCH_LIBRARY, sizeof(params),
+           sizeof(packed8), sizeof(packed16));
+
+    printf("%-10s %12s %12s\n", "bits", "pack ns", "unpack ns");
+    printf("%-10d %12.2f %12.2f\n", 8, ns[0], ns[1]);
+    printf("%-10d %12.2f %12.2f\n", 16, ns[2], ns[3]);
+
+    printf("\n%-10s %4s %9s %9s %9s %9s\n", "preset", "bits", "same", "cents", "ms", "envelope");
+
+    for (int preset = AL_SFXR_RANDOM; preset <= AL_SFXR_BLIP; preset++) {
+        for (int bits = 8; bits <= 16; bits += 8) {
+            unsigned same = 0;
+            double max_cents = 0.0, max_ms = 0.0, max_db = 0.0;
+
+            for (uint64_t seed = 1; seed <= BENCH_SEEDS; seed++) {
+                al_sfxr_Params original, quantized;
+                al_sfxr_generate(&original, (al_sfxr_Preset)preset, 0, seed);
+
+                if (bits == 8) {
+                    al_sfxr_Params8 packed;
+                    al_sfxr_pack8(&packed, &original, 1);
+                    al_sfxr_unpack8(&quantized, &packed, 1);
+                }
+                else {
+                    al_sfxr_Params16 packed;
+                    al_sfxr_pack16(&packed, &original, 1);
+                    al_sfxr_unpack16(&quantized, &packed, 1);
+                }
+
+                size_t const exact_length = al_sfxr_length(&original);
+                size_t const other_length = al_sfxr_length(&quantized);
+                float* const exact = (float*)malloc((exact_length + 1) * sizeof(float));
+                float* const other = (float*)malloc((other_length + 1) * sizeof(float));
+
+                if (exact == NULL || other == NULL) {
+                    fprintf(stderr, "Out of memory\n");
+                    exit(EXIT_FAILURE);
+                }
+
+                size_t const exact_frames = render(&original, seed, 0, 0, exact, exact_length + 1);
+                size_t const other_frames = render(&quantized, seed, 0, 0, other, other_length + 1);
+
+                al_sfxr_Patch a, b;
+                al_sfxr_compile(&a, &original);
+                al_sfxr_compile(&b, &quantized);
+
+                double const cents = fabs(1200.0 * log2(a.fperiod / b.fperiod));
+                double const ms = fabs((double)exact_frames - (double)other_frames) * 1000.0 / 44100.0;
+                double const db = envelope_error(exact, exact_frames, other, other_frames);
+
+                same += compare(exact, exact_frames, other, other_frames) == 0.0;
+                max_cents = cents > max_cents ? cents : max_cents;
+                max_ms = ms > max_ms ? ms : max_ms;
+                max_db = db > max_db ? db : max_db;
+
+                free(exact);
+                free(other);
+            }
+
+            printf("%-10s %4d %5u/%-3d %9.2f %9.2f %9.3f\n", s_preset_names[preset], bits, same, BENCH_SEEDS,
+                   max_cents, max_ms, max_db);
+        }
+    }
+}
+
+/* Returns whether all the frames are finite */
+static int finite(float const* const frames, size_t const num_frames) {
+    for (size_t i = 0; i < num_frames; i++) {
+        if (frames[i] != frames[i] || frames[i] - frames[i] != 0.0f) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+typedef struct {
+    unsigned sounds;
+    unsigned failures;
+}
+Verification;
+
+static void check(Verification* const v, int const ok, char const* const what, al_sfxr_Preset const preset,
+                  unsigned const mutations, uint64_t const seed) {
+    if (!ok) {
+        printf("FAIL %-28s preset %d mutations %u seed %llu\n", what, (int)preset, mutations, (unsigned long long)seed);
+        v->failures++;
+    }
+}
+
+/* Renders a sound of the corpus through every path and checks the ones that
+   must be equal to the exact output, or within the tolerance of the
+   approximate modes, and returns its hashes */
+static Hashes verify_sound(Verification* const v, al_sfxr_Preset const preset, unsigned const mutations,
+                           uint64_t const seed) {
+    static float buffer[BENCH_FRAMES * 2];
+    al_sfxr_Params params;
+    al_sfxr_generate(&params, preset, mutations, seed);
+
+    size_t const length = al_sfxr_length(&params);
+    float* const exact = (float*)malloc((length + 1) * sizeof(float));
+    float* const other = (float*)malloc((length + 1) * sizeof(float));
+    int16_t* const int16 = (int16_t*)malloc((length + 1) * sizeof(int16_t));
+    Hashes hashes;
+
+    if (exact == NULL || other == NULL || int16 == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Selected kernel, generic kernel, and oversampling at 8x */
+    size_t const frames = render(&params, seed, 0, 0, exact, length + 1);
+    hashes.exact = fnv1a(exact, frames * sizeof(float), FNV_OFFSET);
+    check(v, frames == length, "al_sfxr_length", preset, mutations, seed);
+
+    size_t count = render(&params, seed, 0, 1, other, length + 1);
+    check(v, compare(exact, frames, other, count) == 0.0, "generic kernel", preset, mutations, seed);
+
+    al_sfxr_Decoder decoder;
+    al_sfxr_start_ex(&decoder, &params, seed, 44100, 8);
+    count = al_sfxr_produce_block(&decoder, other, length + 1);
+    check(v, compare(exact, frames, other, count) == 0.0, "al_sfxr_start_ex 8x", preset, mutations, seed);
+
+    /* The output formats, in blocks */
+    for (int format = 0; format < 4; format++) {
+        int ok = 1;
+        count = 0;
+
+        al_sfxr_start(&decoder, &params, seed);
+
+        for (;;) {
+            size_t const produced = s_formats[format].produce(&decoder, buffer, BENCH_FRAMES);
+
+            for (size_t i = 0; i < produced && count + i < length + 1; i++) {
+                if (format == 0) {
+                    int16[count + i] = ((int16_t*)buffer)[i];
+                }
+                else if (format == 1) {
+                    ok = ok && ((int16_t*)buffer)[i * 2] == int16[count + i] &&
+                         ((int16_t*)buffer)[i * 2 + 1] == int16[count + i];
+                }
+                else if (format == 2) {
+                    other[count + i] = buffer[i];
+                }
+                else {
+                    ok = ok && compare(exact + count + i, 1, buffer + i * 2, 1) == 0.0 &&
+                         compare(exact + count + i, 1, buffer + i * 2 + 1, 1) == 0.0;
+                }
+            }
+
+            count += produced;
+
+            if (produced < BENCH_FRAMES) {
+                break;
+            }
+        }
+
+        ok = ok && count == frames;
+
+        if (format == 2) {
+            ok = ok && compare(exact, frames, other, count) == 0.0;
+        }
+
+        check(v, ok, s_formats[format].name, preset, mutations, seed);
+    }
+
+    hashes.int16 = fnv1a(int16, frames * sizeof(int16_t), FNV_OFFSET);
+
+    /* Batches and mixers add the voices to silence */
+    {
+        static al_sfxr_DecoderBatch batch;
+        al_sfxr_batch_init(&batch);
+        al_sfxr_batch_start(&batch, 0, &params, seed);
+
+        for (count = 0; count < frames; count += BENCH_FRAMES) {
+            size_t const n = frames - count < BENCH_FRAMES ? frames - count : BENCH_FRAMES;
+            al_sfxr_batch_produce(&batch, other + count, n);
+        }
+
+        check(v, compare(exact, frames, other, frames) == 0.0, "al_sfxr_DecoderBatch", preset, mutations, seed);
+    }
+
+    {
+        static al_sfxr_MixerVoice voices[1];
+        static al_sfxr_PhaserLine lines[1];
+        al_sfxr_Mixer mixer;
+        al_sfxr_Patch patch;
+
+        al_sfxr_mixer_init(&mixer, voices, 1, lines, 1);
+        al_sfxr_compile(&patch, &params);
+        al_sfxr_mixer_play(&mixer, &patch, seed, 1.0f, 0);
+
+        for (count = 0; count < frames; count += BENCH_FRAMES) {
+            size_t const n = frames - count < BENCH_FRAMES ? frames - count : BENCH_FRAMES;
+            al_sfxr_mixer_produce(&mixer, other + count, n);
+        }
+
+        check(v, compare(exact, frames, other, frames) == 0.0, "al_sfxr_Mixer", preset, mutations, seed);
+    }
+
+    /* Fully panned to the left, the left channel gets the voice unchanged */
+    {
+        float* const stereo = (float*)calloc((length + 1) * 2, sizeof(float));
+
+        if (stereo == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        al_sfxr_start(&decoder, &params, seed);
+        count = al_sfxr_mix2f(&decoder, stereo, length + 1, 1.0f, -1.0f, 1);
+
+        for (size_t i = 0; i < count; i++) {
+            other[i] = stereo[i * 2];
+        }
+
+        check(v, compare(exact, frames, other, count) == 0.0, "al_sfxr_mix2f", preset, mutations, seed);
+        free(stereo);
+    }
+
+    /* Quantized parameters are the same after saving and loading them */
+    {
+        al_sfxr_Params8 packed8[2];
+        al_sfxr_Params16 packed16[2];
+        al_sfxr_Params restored;
+        uint8_t saved[AL_SFXR_SAVE_SIZE];
+
+        al_sfxr_pack8(packed8, &params, 1);
+        al_sfxr_unpack8(&restored, packed8, 1);
+        al_sfxr_save_mem(&restored, saved, sizeof(saved));
+        al_sfxr_load_mem(&restored, saved, sizeof(saved));
+        al_sfxr_pack8(packed8 + 1, &restored, 1);
+        check(v, memcmp(packed8, packed8 + 1, sizeof(packed8[0])) == 0, "al_sfxr_pack8", preset, mutations, seed);
+
+        al_sfxr_pack16(packed16, &params, 1);
+        al_sfxr_unpack16(&restored, packed16, 1);
+        al_sfxr_save_mem(&restored, saved, sizeof(saved));
+        al_sfxr_load_mem(&restored, saved, sizeof(saved));
+        al_sfxr_pack16(packed16 + 1, &restored, 1);
+        check(v, memcmp(packed16, packed16 + 1, sizeof(packed16[0])) == 0, "al_sfxr_pack16", preset, mutations,
+              seed);
+    }
+
+    /* Sounds that are finite at 44100 Hz are finite at other rates, also at
+       1x, where the filter coefficients are the largest */
+    if (finite(exact, frames)) {
+        static unsigned const rates[] = {8000, 11025, 22050, 48000};
+
+        for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]) * 2; i++) {
+            unsigned const rate = rates[i / 2];
+            unsigned const oversampling = i % 2 == 0 ? 8 : 1;
+            size_t const rate_length = al_sfxr_length_rate(&params, rate);
+            float* const rate_frames = (float*)malloc((rate_length + 1) * sizeof(float));
+            char what[32];
+
+            if (rate_frames == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+
+            al_sfxr_start_ex(&decoder, &params, seed, rate, oversampling);
+            count = al_sfxr_produce_block(&decoder, rate_frames, rate_length + 1);
+            snprintf(what, sizeof(what), "finite at %u Hz %ux", rate, oversampling);
+            check(v, count == rate_length && finite(rate_frames, count), what, preset, mutations, seed);
+            free(rate_frames);
+        }
+    }
+
+    /* Approximate modes */
+    count = render(&params, seed, AL_SFXR_MODE_FLUSH_DENORMALS, 0, other, length + 1);
+    double error = compare(exact, frames, other, count);
+    check(v, error >= 0.0 && error <= VERIFY_FLUSH_TOLERANCE, "AL_SFXR_MODE_FLUSH_DENORMALS", preset, mutations, seed);
+
+    if (params.p_vib_strength == 0.0f) {
+        count = render(&params, seed, AL_SFXR_MODE_FAST_TRIG, 0, other, length + 1);
+        error = compare(exact, frames, other, count);
+        check(v, error >= 0.0 && error <= VERIFY_FAST_TRIG_TOLERANCE, "AL_SFXR_MODE_FAST_TRIG", preset, mutations,
+              seed);
+    }
+
+    /* Modes that render a different sound */
+    count = render(&params, seed, AL_SFXR_MODE_FAST_NOISE, 0, other, length + 1);
+    hashes.fast_noise = fnv1a(other, count * sizeof(float), FNV_OFFSET);
+
+    count = render(&params, seed, AL_SFXR_MODE_BANDLIMITED, 0, other, length + 1);
+    hashes.bandlimited = fnv1a(other, count * sizeof(float), FNV_OFFSET);
+
+    free(exact);
+    free(other);
+    free(int16);
+
+    v->sounds++;
+    return hashes;
+}
+
+static void expect(Verification* const v, int const ok, char const* const what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        v->failures++;
+    }
+}
+
+/* Returns whether exactly the voices with the given ids are playing */
+static int playing(al_sfxr_Mixer const* const mixer, unsigned const* const ids, unsigned const count) {
+    unsigned found = 0;
+
+    for (unsigned i = 0; i < mixer->num_voices; i++) {
+        unsigned const id = mixer->voices[i].id;
+        int known = 0;
+
+        for (unsigned j = 0; j < count; j++) {
+            known = known || (ids[j] != 0 && ids[j] == id);
+        }
+
+        if (id != 0 && !known) {
+            return 0;
+        }
+
+        found += known;
+    }
+
+    return found == count;
+}
+
+/* Plays sounds that never end in a mixer with 3 voices and 1 phaser delay
+   line, and checks which voices survive each play */
+static void verify_mixer(Verification* const v) {
+    static al_sfxr_MixerVoice voices[3];
+    static al_sfxr_PhaserLine lines[1];
+    al_sfxr_Params params;
+    al_sfxr_Patch plain, phaser;
+    al_sfxr_Mixer mixer;
+
+    memset(&params, 0, sizeof(params));
+    params.p_base_freq = 0.3f;
+    params.p_env_sustain = 1.0f;
+    params.p_lpf_freq = 1.0f;
+    params.sound_vol = 0.5f;
+    al_sfxr_compile(&plain, &params);
+
+    params.p_pha_offset = 0.5f;
+    al_sfxr_compile(&phaser, &params);
+
+    al_sfxr_mixer_init(&mixer, voices, 3, lines, 1);
+
+    /* The oldest voice is stolen among the ones with the lowest priority */
+    unsigned const a = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    unsigned const b = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    unsigned const c = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    unsigned const d = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    expect(v, playing(&mixer, (unsigned[]){b, c, d}, 3) && a != 0, "mixer steals the oldest voice");
+
+    unsigned const e = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, -1);
+    expect(v, e == 0 && playing(&mixer, (unsigned[]){b, c, d}, 3), "mixer refuses lower priorities");
+
+    unsigned const f = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 1);
+    unsigned const g = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    expect(v, playing(&mixer, (unsigned[]){d, f, g}, 3), "mixer steals the lowest priority");
+
+    /* Voices that need a delay line steal it from the voice holding it */
+    al_sfxr_mixer_stop_all(&mixer);
+    unsigned const p1 = al_sfxr_mixer_play(&mixer, &phaser, 1, 1.0f, 0);
+    unsigned const n1 = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    unsigned const n2 = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    unsigned const p2 = al_sfxr_mixer_play(&mixer, &phaser, 1, 1.0f, 0);
+    expect(v, p1 != 0 && playing(&mixer, (unsigned[]){n1, n2, p2}, 3), "mixer steals a voice with its line");
+
+    unsigned const p3 = al_sfxr_mixer_play(&mixer, &phaser, 1, 1.0f, 0);
+    expect(v, playing(&mixer, (unsigned[]){n1, n2, p3}, 3), "mixer steals only the line holder");
+
+    al_sfxr_mixer_stop(&mixer, n1);
+    unsigned const p4 = al_sfxr_mixer_play(&mixer, &phaser, 1, 1.0f, 0);
+    expect(v, playing(&mixer, (unsigned[]){n2, p4}, 2), "mixer steals the line for a free voice");
+
+    al_sfxr_mixer_stop_all(&mixer);
+    unsigned const p5 = al_sfxr_mixer_play(&mixer, &phaser, 1, 1.0f, 2);
+    unsigned const p6 = al_sfxr_mixer_play(&mixer, &phaser, 1, 1.0f, 0);
+    expect(v, p6 == 0 && playing(&mixer, (unsigned[]){p5}, 1), "mixer refuses lines of higher priorities");
+
+    /* The polyphony stops and steals voices like plays do */
+    al_sfxr_mixer_stop_all(&mixer);
+    unsigned const x = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    unsigned const y = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 1);
+    unsigned const z = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    al_sfxr_mixer_set_polyphony(&mixer, 2);
+    expect(v, x != 0 && playing(&mixer, (unsigned[]){y, z}, 2), "al_sfxr_mixer_set_polyphony");
+
+    unsigned const w = al_sfxr_mixer_play(&mixer, &plain, 1, 1.0f, 0);
+    expect(v, playing(&mixer, (unsigned[]){y, w}, 2), "mixer polyphony steals");
+
+    al_sfxr_mixer_set_polyphony(&mixer, 1);
+    expect(v, playing(&mixer, (unsigned[]){y}, 1), "al_sfxr_mixer_set_polyphony lower");
+}
+
+#define VERIFY_PRODUCERS 4
+#define VERIFY_COMMANDS 20000
+
+static pthread_mutex_t s_finished_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned s_finished;
+
+typedef struct {
+    al_sfxr_Queue* queue;
+    unsigned id;
+    unsigned full;
+    pthread_t thread;
+}
+Producer;
+
+/* Sets the gain of the producer's voice to 1, 2, 3..., retrying while the
+   queue is full. A broken queue can stay full forever, so it gives up after
+   a while */
+static void* produce_commands(void* const userdata) {
+    Producer* const producer = (Producer*)userdata;
+    double const start = now();
+
+    for (unsigned i = 1; i <= VERIFY_COMMANDS && now() - start < 60.0; i++) {
+        while (al_sfxr_queue_set_gain(producer->queue, producer->id, (float)i) != 0 && now() - start < 60.0) {
+            producer->full++;
+            sched_yield();
+        }
+    }
+
+    pthread_mutex_lock(&s_finished_lock);
+    s_finished++;
+    pthread_mutex_unlock(&s_finished_lock);
+    return NULL;
+}
+
+/* Pushes gain changes from producer threads to a small queue while this
+   thread drains it, and checks that every command is executed once, and in
+   order for each producer */
+static void verify_queue_threads(Verification* const v, unsigned const num_producers, char const* const what) {
+    static al_sfxr_MixerVoice voices[VERIFY_PRODUCERS];
+    static al_sfxr_QueueSlot slots[8];
+    Producer producers[VERIFY_PRODUCERS];
+    float last[VERIFY_PRODUCERS];
+    al_sfxr_Mixer mixer;
+    al_sfxr_Queue queue;
+    al_sfxr_Params params;
+    al_sfxr_Patch patch;
+
+    memset(&params, 0, sizeof(params));
+    params.p_env_sustain = 1.0f;
+    params.p_lpf_freq = 1.0f;
+    al_sfxr_compile(&patch, &params);
+
+    al_sfxr_mixer_init(&mixer, voices, VERIFY_PRODUCERS, NULL, 0);
+    al_sfxr_queue_init(&queue, &mixer, slots, 8, num_producers > 1);
+    s_finished = 0;
+
+    for (unsigned i = 0; i < num_producers; i++) {
+        producers[i].queue = &queue;
+        producers[i].id = al_sfxr_mixer_play(&mixer, &patch, 1, 0.0f, 0);
+        producers[i].full = 0;
+        last[i] = 0.0f;
+    }
+
+    for (unsigned i = 0; i < num_producers; i++) {
+        if (pthread_create(&producers[i].thread, NULL, produce_commands, producers + i) != 0) {
+            fprintf(stderr, "Error creating a thread\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    unsigned long const total = (unsigned long)num_producers * VERIFY_COMMANDS;
+    unsigned long drained = 0;
+    int ordered = 1;
+
+    /* Lost commands are never drained, stop when the producers are done */
+    while (drained < total) {
+        unsigned const count = al_sfxr_queue_drain(&queue);
+        drained += count;
+
+        if (count == 0) {
+            pthread_mutex_lock(&s_finished_lock);
+            unsigned const finished = s_finished;
+            pthread_mutex_unlock(&s_finished_lock);
+
+            if (finished == num_producers) {
+                unsigned const rest = al_sfxr_queue_drain(&queue);
+                drained += rest;
+
+                if (rest == 0) {
+                    break;
+                }
+            }
+
+            sched_yield();
+        }
+
+        for (unsigned i = 0; i < num_producers; i++) {
+            float const gain = voices[i].gain;
+            ordered = ordered && gain >= last[i];
+            last[i] = gain;
+        }
+    }
+
+    unsigned full = 0;
+
+    for (unsigned i = 0; i < num_producers; i++) {
+        pthread_join(producers[i].thread, NULL);
+        full += producers[i].full;
+        ordered = ordered && voices[i].id == producers[i].id && voices[i].gain == (float)VERIFY_COMMANDS;
+    }
+
+    expect(v, ordered && drained == total && al_sfxr_queue_drain(&queue) == 0, what);
+
+    if (full == 0) {
+        printf("WARN %s never found the queue full\n", what);
+    }
+}
+
+/* Checks the return values of a full queue, and the threaded queues */
+static void verify_queue(Verification* const v) {
+    static al_sfxr_MixerVoice voices[1];
+    static al_sfxr_QueueSlot slots[4];
+    al_sfxr_Mixer mixer;
+    al_sfxr_Queue queue;
+    al_sfxr_Patch patch;
+    al_sfxr_Params params;
+    int ok = 1;
+
+    memset(&params, 0, sizeof(params));
+    params.p_env_sustain = 1.0f;
+    params.p_lpf_freq = 1.0f;
+    al_sfxr_compile(&patch, &params);
+
+    al_sfxr_mixer_init(&mixer, voices, 1, NULL, 0);
+    al_sfxr_queue_init(&queue, &mixer, slots, 4, 0);
+
+    unsigned const id = al_sfxr_queue_play(&queue, &patch, 1, 1.0f, 0);
+    ok = ok && id != 0 && al_sfxr_queue_set_gain(&queue, id, 0.5f) == 0;
+    ok = ok && al_sfxr_queue_stop(&queue, id) == 0 && al_sfxr_queue_stop_all(&queue) == 0;
+
+    /* Full */
+    ok = ok && al_sfxr_queue_play(&queue, &patch, 1, 1.0f, 0) == 0 && al_sfxr_queue_stop(&queue, id) == -1;
+    ok = ok && al_sfxr_queue_stop_all(&queue) == -1 && al_sfxr_queue_set_gain(&queue, id, 1.0f) == -1;
+
+    ok = ok && al_sfxr_queue_drain(&queue) == 4 && voices[0].id == 0 && al_sfxr_queue_drain(&queue) == 0;
+    ok = ok && al_sfxr_queue_play(&queue, &patch, 1, 1.0f, 0) != 0 && al_sfxr_queue_drain(&queue) == 1;
+    expect(v, ok && voices[0].id != 0, "al_sfxr_Queue full");
+
+    verify_queue_threads(v, 1, "al_sfxr_Queue single producer");
+    verify_queue_threads(v, VERIFY_PRODUCERS, "al_sfxr_Queue multiple producers");
+}
+
+/* Writes the hashes of the corpus to the reference file, or checks them
+   against it */
+static int verify(char const* const path, int const write) {
+    FILE* const fp = fopen(path, write ? "w" : "r");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Error opening \"%s\"\n", path);
+        return EXIT_FAILURE;
+    }
+
+    Verification v = {0, 0};
+
+    if (write) {
+        fprintf(fp, "# preset mutations seed exact int16 fast_noise bandlimited\n");
+    }
+    else {
+        char line[256];
+
+        if (fgets(line, sizeof(line), fp) == NULL) {
+            fprintf(stderr, "Error reading \"%s\"\n", path);
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (int preset = AL_SFXR_RANDOM; preset <= AL_SFXR_BLIP; preset++) {
+        for (unsigned mutations = 0; mutations < VERIFY_MUTATIONS; mutations++) {
+            for (uint64_t seed = 1; seed <= VERIFY_SEEDS; seed++) {
+                Hashes const hashes = verify_sound(&v, (al_sfxr_Preset)preset, mutations * 5, seed);
+
+                if (write) {
+                    fprintf(fp, "%d %u %llu %016llx %016llx %016llx %016llx\n", preset, mutations * 5,
+                            (unsigned long long)seed, (unsigned long long)hashes.exact,
+                            (unsigned long long)hashes.int16, (unsigned long long)hashes.fast_noise,
+                            (unsigned long long)hashes.bandlimited);
+
+                    continue;
+                }
+
+                int p;
+                unsigned m;
+                unsigned long long s, exact, int16, fast_noise, bandlimited;
+
+                if (fscanf(fp, "%d %u %llu %llx %llx %llx %llx", &p, &m, &s, &exact, &int16, &fast_noise,
+                           &bandlimited) != 7 || p != preset || m != mutations * 5 || s != seed) {
+
+                    fprintf(stderr, "Reference file \"%s\" doesn't match the corpus\n", path);
+                    fclose(fp);
+                    return EXIT_FAILURE;
+                }
+
+                check(&v, hashes.exact == exact, "exact hash", (al_sfxr_Preset)preset, m, seed);
+                check(&v, hashes.int16 == int16, "int16 hash", (al_sfxr_Preset)preset, m, seed);
+                check(&v, hashes.fast_noise == fast_noise, "AL_SFXR_MODE_FAST_NOISE hash", (al_sfxr_Preset)preset,
+                      m, seed);
+                check(&v, hashes.bandlimited == bandlimited, "AL_SFXR_MODE_BANDLIMITED hash",
+                      (al_sfxr_Preset)preset, m, seed);
+            }
+        }
+    }
+
+    fclose(fp);
+    verify_mixer(&v);
+    verify_queue(&v);
+    printf("%u sounds, %u failures\n", v.sounds, v.failures);
+    return v.failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+    static Sweep result;
+
+    if (argc == 3 && strcmp(argv[1], "--verify") == 0) {
+        return verify(argv[2], 0);
+    }
+    else if (argc == 3 && strcmp(argv[1], "--reference") == 0) {
+        return verify(argv[2], 1);
+    }
+
+    if (argc == 2 || argc == 3) {
+        if (strcmp(argv[1], "--json") != 0) {
+            fprintf(stderr, "Usage: %s [--json [file] | --verify file | --reference file]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        FILE* const fp = argc == 3 ? fopen(argv[2], "w") : stdout;
+
+        if (fp == NULL) {
+            fprintf(stderr, "Error opening \"%s\"\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+
+        sweep(&result);
+        write_json(fp, &result);
+
+        if (fp != stdout) {
+            fclose(fp);
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    sweep(&result);
+    bench_sweep(&result);
+    bench_kernels();
+    bench_trig();
+    bench_noise();
+    bench_denormals();
+    bench_start();
+    bench_load();
+    bench_seedbank();
+    bench_quantize();
+    bench_cache();
+    bench_batch();
+    bench_mixer();
+    bench_mix();
+    bench_oversampling();
+
+#if defined(AL_SFXR_PROFILE)
+    bench_profile();
+#endif
+
+    return EXIT_SUCCESS;
+}
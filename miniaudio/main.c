@@ -16,20 +16,19 @@
 #define AL_SFXR_LOAD
 #define AL_SFXR_SAVE
 #define AL_SFXR_FLOAT_MONO
+#define AL_SFXR_MIXER
 #include "../al_sfxr.h"
 /*---------------------------------------------------------------------------*/
 
 typedef struct {
-    al_sfxr_Decoder* const decoder;
-    int volatile playing;
+    al_sfxr_Mixer mixer;
+    al_sfxr_Queue queue;
+    ma_event finished;
+    int started;
+    int signaled;
 }
 ud_t;
 
-static int fpreader(void* const userdata, uint8_t* const byte) {
-    FILE* const fp = (FILE*)userdata;
-    return fread(byte, 1, 1, fp) != 1;
-}
-
 static int load_sound(char const* const filename, al_sfxr_Params* const params) {
     FILE* const fp = fopen(filename, "rb");
 
@@ -38,9 +37,13 @@ static int load_sound(char const* const filename, al_sfxr_Params* const params)
         return -1;
     }
 
-    int const res = al_sfxr_load(params, fpreader, fp);
+    /* .sfxr files are small, read them with a single call */
+    uint8_t data[256];
+    size_t const size = fread(data, 1, sizeof(data), fp);
     fclose(fp);
 
+    int const res = al_sfxr_load_mem(params, data, size);
+
     if (res != 0) {
         fprintf(stderr, "Error loading \"%s\": %s\n", filename, strerror(errno));
     }
@@ -52,8 +55,14 @@ void data_callback(ma_device* const device, void* const output, const void* cons
     (void)input;
 
     ud_t* const ud = (ud_t*)device->pUserData;
-    size_t count = al_sfxr_produce1f(ud->decoder, output, frame_count);
-    ud->playing = count != 0;
+    ud->started += al_sfxr_queue_drain(&ud->queue) != 0;
+    unsigned const playing = al_sfxr_mixer_produce(&ud->mixer, (float*)output, frame_count);
+
+    /* Only the audio thread touches started and signaled */
+    if (ud->started && playing == 0 && !ud->signaled) {
+        ud->signaled = 1;
+        ma_event_signal(&ud->finished);
+    }
 }
 
 int main(int argc, char** argv) {
@@ -68,9 +77,22 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
-    al_sfxr_Decoder decoder;
-    al_sfxr_start_quick(&decoder, &params);
-    ud_t ud = {&decoder, 1};
+    static al_sfxr_MixerVoice voices[1];
+    static al_sfxr_PhaserLine lines[1];
+    static al_sfxr_QueueSlot slots[4];
+    static ud_t ud;
+
+    al_sfxr_mixer_init(&ud.mixer, voices, 1, lines, 1);
+    al_sfxr_queue_init(&ud.queue, &ud.mixer, slots, 4, 0);
+
+    if (ma_event_init(&ud.finished) != MA_SUCCESS) {
+        fprintf(stderr, "Failed to create event.\n");
+        return EXIT_FAILURE;
+    }
+
+    al_sfxr_Patch patch;
+    al_sfxr_compile(&patch, &params);
+    al_sfxr_queue_play(&ud.queue, &patch, UINT64_C(0x89866ae81aa30a2b), 1.0f, 0);
 
     ma_device_config device_config;
 
@@ -85,17 +107,20 @@ int main(int argc, char** argv) {
 
     if (ma_device_init(NULL, &device_config, &device) != MA_SUCCESS) {
         printf("Failed to open playback device.\n");
+        ma_event_uninit(&ud.finished);
         return EXIT_FAILURE;
     }
 
     if (ma_device_start(&device) != MA_SUCCESS) {
         fprintf(stderr, "Failed to start playback device.\n");
         ma_device_uninit(&device);
+        ma_event_uninit(&ud.finished);
         return EXIT_FAILURE;
     }
 
-    while (ud.playing) /* nothing */;
+    ma_event_wait(&ud.finished);
 
     ma_device_uninit(&device);
+    ma_event_uninit(&ud.finished);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*---------------------------------------------------------------------------*/
+/* al_sfxr config and inclusion */
+#define AL_SFXR_IMPLEMENTATION
+#define AL_SFXR_GENERATE
+#define AL_SFXR_LOAD
+#define AL_SFXR_BANK
+#include "../al_sfxr.h"
+/*---------------------------------------------------------------------------*/
+
+/* A sound to pack, either loaded from a .sfxr file and named after it
+   without the directory and the extension, or generated from a manifest
+   entry */
+typedef struct {
+    char* path;
+    char* name;
+    uint32_t id;
+    int generated;
+    al_sfxr_Seed seed;
+}
+sound_t;
+
+static sound_t* s_sounds = NULL;
+static size_t s_num_sounds = 0;
+static size_t s_max_sounds = 0;
+
+static struct {char const* name; al_sfxr_Preset preset;} const s_presets[8] = {
+    {"random", AL_SFXR_RANDOM},
+    {"pickup", AL_SFXR_PICKUP},
+    {"laser", AL_SFXR_LASER},
+    {"explosion", AL_SFXR_EXPLOSION},
+    {"powerup", AL_SFXR_POWERUP},
+    {"hit", AL_SFXR_HIT},
+    {"jump", AL_SFXR_JUMP},
+    {"blip", AL_SFXR_BLIP}
+};
+
+static char* join_path(char const* const dir, char const* const name) {
+    size_t const dir_len = strlen(dir);
+    size_t const name_len = strlen(name);
+    char* const path = (char*)malloc(dir_len + name_len + 2);
+
+    if (path == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(path, dir, dir_len);
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, name, name_len + 1);
+    return path;
+}
+
+static int is_sfxr(char const* const name) {
+    size_t const length = strlen(name);
+    return length > 5 && strcasecmp(name + length - 5, ".sfxr") == 0;
+}
+
+static sound_t* add_sound(char const* const path, char const* const name, size_t const name_len) {
+    if (s_num_sounds == s_max_sounds) {
+        size_t const max_sounds = s_max_sounds == 0 ? 256 : s_max_sounds * 2;
+        sound_t* const sounds = (sound_t*)realloc(s_sounds, max_sounds * sizeof(sound_t));
+
+        if (sounds == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        s_sounds = sounds;
+        s_max_sounds = max_sounds;
+    }
+
+    sound_t* const sound = s_sounds + s_num_sounds++;
+    memset(sound, 0, sizeof(*sound));
+    sound->path = strdup(path);
+    sound->name = strndup(name, name_len);
+
+    if (sound->path == NULL || sound->name == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sound->id = al_sfxr_bank_hash(sound->name);
+    return sound;
+}
+
+static void add_file(char const* const path) {
+    char const* name = strrchr(path, '/');
+    name = name == NULL ? path : name + 1;
+    add_sound(path, name, strlen(name) - 5);
+}
+
+static int add_directory(char const* const path) {
+    DIR* const dir = opendir(path);
+
+    if (dir == NULL) {
+        fprintf(stderr, "Error opening \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int res = 0;
+    struct dirent* entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        char* const child = join_path(path, entry->d_name);
+        struct stat st;
+
+        if (stat(child, &st) != 0) {
+            fprintf(stderr, "Error reading \"%s\": %s\n", child, strerror(errno));
+            res = -1;
+        }
+        else if (S_ISDIR(st.st_mode)) {
+            res |= add_directory(child);
+        }
+        else if (S_ISREG(st.st_mode) && is_sfxr(entry->d_name)) {
+            add_file(child);
+        }
+
+        free(child);
+    }
+
+    closedir(dir);
+    return res;
+}
+
+static int find_preset(char const* name, al_sfxr_Preset* const preset) {
+    if (strncasecmp(name, "AL_SFXR_", 8) == 0) {
+        name += 8;
+    }
+
+    for (size_t i = 0; i < sizeof(s_presets) / sizeof(s_presets[0]); i++) {
+        if (strcasecmp(name, s_presets[i].name) == 0) {
+            *preset = s_presets[i].preset;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* Each line of a manifest is a sound name followed by a preset name, the
+   number of mutations, the seed, and optionally the volume. Empty lines and
+   lines starting with # are ignored. */
+static int add_manifest(char const* const path) {
+    FILE* const fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Error opening \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char line[4096];
+    unsigned line_num = 0;
+    int res = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_num++;
+
+        char* begin = line;
+        char* end = line + strlen(line);
+
+        while (*begin == ' ' || *begin == '\t') {
+            begin++;
+        }
+
+        while (end > begin && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = 0;
+        }
+
+        if (*begin == 0 || *begin == '#') {
+            continue;
+        }
+
+        char name[256];
+        char preset_name[64];
+        unsigned mutations;
+        unsigned long long seed;
+        float volume = -1.0f;
+        char extra;
+        al_sfxr_Preset preset;
+
+        int const fields = sscanf(begin, "%255s %63s %u %llu %f %c", name, preset_name, &mutations, &seed, &volume,
+                                  &extra);
+
+        if ((fields == 4 || fields == 5) && find_preset(preset_name, &preset) == 0 && mutations <= 0xffff &&
+            volume <= 1.0f) {
+            sound_t* const sound = add_sound(path, name, strlen(name));
+            sound->generated = 1;
+            sound->seed.preset = preset;
+            sound->seed.mutations = mutations;
+            sound->seed.seed = (uint64_t)seed;
+            sound->seed.volume = volume;
+        }
+        else {
+            fprintf(stderr, "%s:%u: invalid entry \"%s\"\n", path, line_num, begin);
+            res = -1;
+        }
+    }
+
+    fclose(fp);
+    return res;
+}
+
+static int load_sound(char const* const path, al_sfxr_Params* const params) {
+    FILE* const fp = fopen(path, "rb");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Error opening \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    /* .sfxr files are small, read them with a single call */
+    uint8_t data[256];
+    size_t const size = fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+
+    if (al_sfxr_load_mem(params, data, size) != 0) {
+        fprintf(stderr, "Error loading \"%s\"\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int compare_ids(void const* const a, void const* const b) {
+    uint32_t const id_a = ((sound_t const*)a)->id;
+    uint32_t const id_b = ((sound_t const*)b)->id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+/* Loads or generates all the sounds and writes them to the bank file with a
+   single call, or writes their seeds to a seed bank */
+static int pack(char const* const path, int const seeds) {
+    /* Sorted by id to report duplicated names and hash collisions */
+    qsort(s_sounds, s_num_sounds, sizeof(sound_t), compare_ids);
+
+    for (size_t i = 1; i < s_num_sounds; i++) {
+        if (s_sounds[i].id == s_sounds[i - 1].id) {
+            fprintf(stderr, "\"%s\" and \"%s\" have the same id %08x\n", s_sounds[i - 1].path, s_sounds[i].path,
+                    (unsigned)s_sounds[i].id);
+
+            return -1;
+        }
+    }
+
+    size_t const size = seeds ? al_sfxr_seedbank_size(s_num_sounds) : al_sfxr_bank_size(s_num_sounds);
+    al_sfxr_Params* const params = (al_sfxr_Params*)malloc(s_num_sounds * sizeof(al_sfxr_Params) + 1);
+    al_sfxr_Seed* const seed = (al_sfxr_Seed*)malloc(s_num_sounds * sizeof(al_sfxr_Seed) + 1);
+    uint32_t* const ids = (uint32_t*)malloc(s_num_sounds * sizeof(uint32_t) + 1);
+    void* const bank = malloc(size);
+
+    if (params == NULL || seed == NULL || ids == NULL || bank == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int res = 0;
+
+    for (size_t i = 0; i < s_num_sounds; i++) {
+        sound_t const* const sound = s_sounds + i;
+        ids[i] = sound->id;
+
+        if (sound->generated) {
+            seed[i] = sound->seed;
+            al_sfxr_generate(params + i, sound->seed.preset, sound->seed.mutations, sound->seed.seed);
+
+            if (sound->seed.volume >= 0.0f) {
+                params[i].sound_vol = sound->seed.volume;
+            }
+        }
+        else if (seeds) {
+            fprintf(stderr, "\"%s\" can't be in a seed bank\n", sound->path);
+            res = -1;
+        }
+        else {
+            res |= load_sound(sound->path, params + i);
+        }
+    }
+
+    if (res == 0) {
+        if (seeds) {
+            al_sfxr_seedbank_write(bank, size, seed, ids, s_num_sounds);
+        }
+        else {
+            al_sfxr_bank_write(bank, size, params, ids, s_num_sounds);
+        }
+
+        FILE* const fp = fopen(path, "wb");
+
+        if (fp == NULL) {
+            fprintf(stderr, "Error opening \"%s\": %s\n", path, strerror(errno));
+            res = -1;
+        }
+        else {
+            res = fwrite(bank, 1, size, fp) != size;
+            res = fclose(fp) != 0 || res;
+
+            if (res != 0) {
+                fprintf(stderr, "Error writing \"%s\": %s\n", path, strerror(errno));
+            }
+        }
+    }
+
+    if (res == 0) {
+        printf("%zu sounds, %zu bytes\n", s_num_sounds, size);
+    }
+
+    free(bank);
+    free(ids);
+    free(seed);
+    free(params);
+    return res;
+}
+
+/* Maps the bank and prints the id of each sound with its wave type, the
+   records are used straight from the mapping. Sounds in seed banks are
+   generated, and also printed with their seeds */
+static int list(char const* const path) {
+    int const fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error opening \"%s\": %s\n", path, strerror(errno));
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return -1;
+    }
+
+    size_t const size = (size_t)st.st_size;
+    void* const data = size != 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    al_sfxr_Bank bank;
+    al_sfxr_SeedBank seeds;
+    int const is_seeds = data != MAP_FAILED && al_sfxr_seedbank_open(&seeds, data, size) == 0;
+
+    if (data == MAP_FAILED || (!is_seeds && al_sfxr_bank_open(&bank, data, size) != 0)) {
+        fprintf(stderr, "Error opening bank \"%s\"\n", path);
+
+        if (data != MAP_FAILED) {
+            munmap(data, size);
+        }
+
+        return -1;
+    }
+
+    static char const* const waves[] = {"square", "sawtooth", "sinewave", "noise"};
+
+    uint32_t const count = is_seeds ? seeds.count : bank.count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t const id = is_seeds ? seeds.index[i].id : bank.index[i].id;
+        al_sfxr_Params generated;
+        al_sfxr_Params const* const params = is_seeds ? al_sfxr_seedbank_find(&seeds, id, &generated) :
+                                                        al_sfxr_bank_find(&bank, id);
+        unsigned const wave_type = (unsigned)params->wave_type;
+
+        printf("%08x %-8s %.3f", (unsigned)id, wave_type < 4 ? waves[wave_type] : "?", (double)params->sound_vol);
+
+        if (is_seeds) {
+            al_sfxr_Seed seed;
+            al_sfxr_seedbank_seed(&seeds, seeds.index[i].record, &seed);
+            printf(" %s %u %llu", s_presets[seed.preset].name, seed.mutations, (unsigned long long)seed.seed);
+        }
+
+        printf("\n");
+    }
+
+    munmap(data, size);
+    return 0;
+}
+
+static void usage(char const* const name) {
+    fprintf(stderr, "Usage: %s [-s] -o bank inputs...\n", name);
+    fprintf(stderr, "       %s -l bank\n\n", name);
+    fprintf(stderr, "Inputs can be .sfxr files, directories which are searched recursively for\n");
+    fprintf(stderr, ".sfxr files, or manifests with one \"name preset mutations seed [volume]\"\n");
+    fprintf(stderr, "entry per line. -s writes a seed bank, which only takes manifests.\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "-l") == 0) {
+        return list(argv[2]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int const seeds = argc > 1 && strcmp(argv[1], "-s") == 0;
+
+    if (argc < 4 + seeds || strcmp(argv[1 + seeds], "-o") != 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int res = 0;
+
+    for (int i = 3 + seeds; i < argc; i++) {
+        struct stat st;
+
+        if (stat(argv[i], &st) != 0) {
+            fprintf(stderr, "Error reading \"%s\": %s\n", argv[i], strerror(errno));
+            res = -1;
+        }
+        else if (S_ISDIR(st.st_mode)) {
+            res |= add_directory(argv[i]);
+        }
+        else if (is_sfxr(argv[i])) {
+            add_file(argv[i]);
+        }
+        else {
+            res |= add_manifest(argv[i]);
+        }
+    }
+
+    res = res != 0 ? res : pack(argv[2 + seeds], seeds);
+
+    for (size_t i = 0; i < s_num_sounds; i++) {
+        free(s_sounds[i].path);
+        free(s_sounds[i].name);
+    }
+
+    free(s_sounds);
+    return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
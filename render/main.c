@@ -0,0 +1,649 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/*---------------------------------------------------------------------------*/
+/* al_sfxr config and inclusion */
+#define AL_SFXR_IMPLEMENTATION
+#define AL_SFXR_GENERATE
+#define AL_SFXR_LOAD
+#define AL_SFXR_INT16_MONO
+#include "../al_sfxr.h"
+/*---------------------------------------------------------------------------*/
+
+#define WAV_HEADER_SIZE 44
+#define MAX_THREADS 256
+
+/* A sound to render, either loaded from a .sfxr file or generated from a
+   preset, a mutation count, and a seed */
+typedef struct {
+    char* input;
+    al_sfxr_Preset preset;
+    unsigned mutations;
+    uint64_t seed;
+    char* output;
+}
+job_t;
+
+/* Each worker owns a range of the jobs, takes jobs from its start, and steals
+   the second half of the range of another worker when its range is empty */
+typedef struct {
+    pthread_mutex_t lock;
+    size_t begin;
+    size_t end;
+
+    pthread_t thread;
+    uint8_t* buffer;
+    size_t buffer_size;
+
+    size_t files;
+    size_t frames;
+    size_t bytes;
+    size_t failures;
+    size_t steals;
+}
+worker_t;
+
+static job_t* s_jobs = NULL;
+static size_t s_num_jobs = 0;
+static size_t s_max_jobs = 0;
+
+static worker_t* s_workers = NULL;
+static unsigned s_num_workers = 0;
+
+static char const* s_output_dir = ".";
+static unsigned s_sample_rate = 44100;
+
+static struct {char const* name; al_sfxr_Preset preset;} const s_presets[8] = {
+    {"random", AL_SFXR_RANDOM},
+    {"pickup", AL_SFXR_PICKUP},
+    {"laser", AL_SFXR_LASER},
+    {"explosion", AL_SFXR_EXPLOSION},
+    {"powerup", AL_SFXR_POWERUP},
+    {"hit", AL_SFXR_HIT},
+    {"jump", AL_SFXR_JUMP},
+    {"blip", AL_SFXR_BLIP}
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char* join_path(char const* const dir, char const* const name) {
+    size_t const dir_len = strlen(dir);
+    size_t const name_len = strlen(name);
+    char* const path = (char*)malloc(dir_len + name_len + 2);
+
+    if (path == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(path, dir, dir_len);
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, name, name_len + 1);
+    return path;
+}
+
+static job_t* add_job(void) {
+    if (s_num_jobs == s_max_jobs) {
+        size_t const max_jobs = s_max_jobs == 0 ? 256 : s_max_jobs * 2;
+        job_t* const jobs = (job_t*)realloc(s_jobs, max_jobs * sizeof(job_t));
+
+        if (jobs == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+
+        s_jobs = jobs;
+        s_max_jobs = max_jobs;
+    }
+
+    job_t* const job = s_jobs + s_num_jobs++;
+    memset(job, 0, sizeof(*job));
+    return job;
+}
+
+static void add_file(char const* const path) {
+    char const* name = strrchr(path, '/');
+    name = name == NULL ? path : name + 1;
+
+    /* The output is the file name with the extension replaced by .wav */
+    size_t length = strlen(name);
+
+    if (length > 5 && strcasecmp(name + length - 5, ".sfxr") == 0) {
+        length -= 5;
+    }
+
+    char* const wav = (char*)malloc(length + 5);
+
+    if (wav == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(wav, name, length);
+    memcpy(wav + length, ".wav", 5);
+
+    job_t* const job = add_job();
+    job->input = strdup(path);
+    job->output = join_path(s_output_dir, wav);
+    free(wav);
+}
+
+static void add_generated(al_sfxr_Preset const preset, unsigned const mutations, uint64_t const seed) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s_%u_%llu.wav", s_presets[preset].name, mutations, (unsigned long long)seed);
+
+    job_t* const job = add_job();
+    job->preset = preset;
+    job->mutations = mutations;
+    job->seed = seed;
+    job->output = join_path(s_output_dir, name);
+}
+
+static int is_sfxr(char const* const name) {
+    size_t const length = strlen(name);
+    return length > 5 && strcasecmp(name + length - 5, ".sfxr") == 0;
+}
+
+static int add_directory(char const* const path) {
+    DIR* const dir = opendir(path);
+
+    if (dir == NULL) {
+        fprintf(stderr, "Error opening \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    int res = 0;
+    struct dirent* entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        char* const child = join_path(path, entry->d_name);
+        struct stat st;
+
+        if (stat(child, &st) != 0) {
+            fprintf(stderr, "Error reading \"%s\": %s\n", child, strerror(errno));
+            res = -1;
+        }
+        else if (S_ISDIR(st.st_mode)) {
+            res |= add_directory(child);
+        }
+        else if (S_ISREG(st.st_mode) && is_sfxr(entry->d_name)) {
+            add_file(child);
+        }
+
+        free(child);
+    }
+
+    closedir(dir);
+    return res;
+}
+
+static int find_preset(char const* name, al_sfxr_Preset* const preset) {
+    if (strncasecmp(name, "AL_SFXR_", 8) == 0) {
+        name += 8;
+    }
+
+    for (size_t i = 0; i < sizeof(s_presets) / sizeof(s_presets[0]); i++) {
+        if (strcasecmp(name, s_presets[i].name) == 0) {
+            *preset = s_presets[i].preset;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* Each line of a manifest is either a path to a .sfxr file, relative to the
+   manifest, or a preset name followed by the number of mutations and the
+   seed. Empty lines and lines starting with # are ignored. */
+static int add_manifest(char const* const path) {
+    FILE* const fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Error opening \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char* const dir = strdup(path);
+    char* const slash = strrchr(dir, '/');
+
+    if (slash != NULL) {
+        *slash = 0;
+    }
+
+    char line[4096];
+    unsigned line_num = 0;
+    int res = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        line_num++;
+
+        char* begin = line;
+        char* end = line + strlen(line);
+
+        while (*begin == ' ' || *begin == '\t') {
+            begin++;
+        }
+
+        while (end > begin && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = 0;
+        }
+
+        if (*begin == 0 || *begin == '#') {
+            continue;
+        }
+
+        char name[64];
+        unsigned mutations;
+        unsigned long long seed;
+        char extra;
+        al_sfxr_Preset preset;
+
+        if (sscanf(begin, "%63s %u %llu %c", name, &mutations, &seed, &extra) == 3 && find_preset(name, &preset) == 0) {
+            add_generated(preset, mutations, (uint64_t)seed);
+        }
+        else if (is_sfxr(begin)) {
+            if (*begin == '/' || slash == NULL) {
+                add_file(begin);
+            }
+            else {
+                char* const file = join_path(dir, begin);
+                add_file(file);
+                free(file);
+            }
+        }
+        else {
+            fprintf(stderr, "%s:%u: invalid entry \"%s\"\n", path, line_num, begin);
+            res = -1;
+        }
+    }
+
+    free(dir);
+    fclose(fp);
+    return res;
+}
+
+static int load_sound(worker_t* const worker, char const* const path, al_sfxr_Params* const params) {
+    FILE* const fp = fopen(path, "rb");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Error opening \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    /* .sfxr files are small, read them with a single call into the WAV
+       buffer, which is overwritten later */
+    if (worker->buffer_size < 4096) {
+        uint8_t* const buffer = (uint8_t*)realloc(worker->buffer, 4096);
+
+        if (buffer == NULL) {
+            fclose(fp);
+            fprintf(stderr, "Out of memory\n");
+            return -1;
+        }
+
+        worker->buffer = buffer;
+        worker->buffer_size = 4096;
+    }
+
+    size_t const size = fread(worker->buffer, 1, worker->buffer_size, fp);
+    fclose(fp);
+
+    if (al_sfxr_load_mem(params, worker->buffer, size) != 0) {
+        fprintf(stderr, "Error loading \"%s\"\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void write_u16(uint8_t* const data, uint16_t const value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+}
+
+static void write_u32(uint8_t* const data, uint32_t const value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+/* Renders the whole sound into the worker buffer, after a mono 16-bit PCM
+   WAV header, and writes the file with a single call */
+static int render(worker_t* const worker, job_t const* const job) {
+    al_sfxr_Params params;
+
+    if (job->input != NULL) {
+        if (load_sound(worker, job->input, &params) != 0) {
+            return -1;
+        }
+    }
+    else {
+        al_sfxr_generate(&params, job->preset, job->mutations, job->seed);
+    }
+
+    size_t const num_frames = al_sfxr_length_rate(&params, s_sample_rate);
+    size_t const data_size = num_frames * sizeof(int16_t);
+    size_t const size = WAV_HEADER_SIZE + data_size;
+
+    if (worker->buffer_size < size) {
+        uint8_t* const buffer = (uint8_t*)realloc(worker->buffer, size);
+
+        if (buffer == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return -1;
+        }
+
+        worker->buffer = buffer;
+        worker->buffer_size = size;
+    }
+
+    uint8_t* const header = worker->buffer;
+    memcpy(header, "RIFF", 4);
+    write_u32(header + 4, (uint32_t)(size - 8));
+    memcpy(header + 8, "WAVEfmt ", 8);
+    write_u32(header + 16, 16);
+    write_u16(header + 20, 1);
+    write_u16(header + 22, 1);
+    write_u32(header + 24, s_sample_rate);
+    write_u32(header + 28, s_sample_rate * sizeof(int16_t));
+    write_u16(header + 32, sizeof(int16_t));
+    write_u16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    write_u32(header + 40, (uint32_t)data_size);
+
+    al_sfxr_Decoder decoder;
+    al_sfxr_start_rate(&decoder, &params, UINT64_C(0x89866ae81aa30a2b), s_sample_rate);
+
+    int16_t* const frames = (int16_t*)(worker->buffer + WAV_HEADER_SIZE);
+    size_t const produced = al_sfxr_produce1i(&decoder, frames, num_frames);
+
+    /* WAV samples are little-endian */
+    uint16_t const one = 1;
+
+    if (*(uint8_t const*)&one == 0) {
+        for (size_t i = 0; i < produced; i++) {
+            write_u16((uint8_t*)(frames + i), (uint16_t)frames[i]);
+        }
+    }
+
+    FILE* const fp = fopen(job->output, "wb");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Error creating \"%s\": %s\n", job->output, strerror(errno));
+        return -1;
+    }
+
+    setvbuf(fp, NULL, _IONBF, 0);
+    size_t const written = fwrite(worker->buffer, 1, size, fp);
+
+    if (fclose(fp) != 0 || written != size) {
+        fprintf(stderr, "Error writing \"%s\": %s\n", job->output, strerror(errno));
+        return -1;
+    }
+
+    worker->files++;
+    worker->frames += produced;
+    worker->bytes += size;
+    return 0;
+}
+
+/* Takes the next job of the worker, or steals half of the jobs left in the
+   worker that has the most of them */
+static int next_job(worker_t* const worker, size_t* const index) {
+    while (1) {
+        pthread_mutex_lock(&worker->lock);
+
+        if (worker->begin < worker->end) {
+            *index = worker->begin++;
+            pthread_mutex_unlock(&worker->lock);
+            return 0;
+        }
+
+        pthread_mutex_unlock(&worker->lock);
+
+        worker_t* victim = NULL;
+        size_t most = 0;
+
+        for (unsigned i = 0; i < s_num_workers; i++) {
+            worker_t* const other = s_workers + i;
+
+            if (other == worker) {
+                continue;
+            }
+
+            pthread_mutex_lock(&other->lock);
+            size_t const left = other->end - other->begin;
+            pthread_mutex_unlock(&other->lock);
+
+            if (left > most) {
+                victim = other;
+                most = left;
+            }
+        }
+
+        if (victim == NULL) {
+            return -1;
+        }
+
+        pthread_mutex_lock(&victim->lock);
+        size_t const left = victim->end - victim->begin;
+
+        if (left == 0) {
+            /* Someone else got there first, look again */
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+
+        size_t const end = victim->end;
+        victim->end -= (left + 1) / 2;
+        size_t const begin = victim->end;
+        pthread_mutex_unlock(&victim->lock);
+
+        /* Only this worker refills its empty range */
+        pthread_mutex_lock(&worker->lock);
+        worker->begin = begin;
+        worker->end = end;
+        worker->steals++;
+        pthread_mutex_unlock(&worker->lock);
+    }
+}
+
+static void* worker_main(void* const arg) {
+    worker_t* const worker = (worker_t*)arg;
+    size_t index;
+
+    while (next_job(worker, &index) == 0) {
+        if (render(worker, s_jobs + index) != 0) {
+            worker->failures++;
+        }
+    }
+
+    return NULL;
+}
+
+static int compare_outputs(void const* const a, void const* const b) {
+    return strcmp(((job_t const*)a)->output, ((job_t const*)b)->output);
+}
+
+/* Workers would write jobs with the same output to the same file at the same
+   time, so they're reported before rendering anything */
+static int check_outputs(void) {
+    qsort(s_jobs, s_num_jobs, sizeof(job_t), compare_outputs);
+    int res = 0;
+
+    for (size_t i = 1; i < s_num_jobs; i++) {
+        if (strcmp(s_jobs[i].output, s_jobs[i - 1].output) == 0) {
+            fprintf(stderr, "Two inputs would be written to \"%s\":", s_jobs[i].output);
+
+            for (size_t j = i - 1; j <= i; j++) {
+                job_t const* const job = s_jobs + j;
+
+                if (job->input != NULL) {
+                    fprintf(stderr, " \"%s\"", job->input);
+                }
+                else {
+                    fprintf(stderr, " \"%s %u %llu\"", s_presets[job->preset].name, job->mutations,
+                            (unsigned long long)job->seed);
+                }
+            }
+
+            fputc('\n', stderr);
+            res = -1;
+        }
+    }
+
+    return res;
+}
+
+static void usage(char const* const name) {
+    fprintf(stderr, "Usage: %s [-j threads] [-o output_dir] [-r sample_rate] inputs...\n\n", name);
+    fprintf(stderr, "Inputs can be .sfxr files, directories which are searched recursively for\n");
+    fprintf(stderr, ".sfxr files, or manifests with one .sfxr path or \"preset mutations seed\"\n");
+    fprintf(stderr, "entry per line.\n");
+}
+
+int main(int argc, char** argv) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 1;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            s_output_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            s_sample_rate = (unsigned)strtoul(argv[++i], NULL, 10);
+
+            if (s_sample_rate < AL_SFXR_MIN_RATE || s_sample_rate > AL_SFXR_MAX_RATE) {
+                fprintf(stderr, "Invalid sample rate %u\n", s_sample_rate);
+                return EXIT_FAILURE;
+            }
+        }
+        else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (i == argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    threads = threads < 1 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+
+    if (mkdir(s_output_dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error creating \"%s\": %s\n", s_output_dir, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int res = 0;
+
+    for (; i < argc; i++) {
+        struct stat st;
+
+        if (stat(argv[i], &st) != 0) {
+            fprintf(stderr, "Error reading \"%s\": %s\n", argv[i], strerror(errno));
+            res = -1;
+        }
+        else if (S_ISDIR(st.st_mode)) {
+            res |= add_directory(argv[i]);
+        }
+        else if (is_sfxr(argv[i])) {
+            add_file(argv[i]);
+        }
+        else {
+            res |= add_manifest(argv[i]);
+        }
+    }
+
+    if (check_outputs() != 0) {
+        return EXIT_FAILURE;
+    }
+
+    s_num_workers = (unsigned)threads;
+    s_workers = (worker_t*)calloc(s_num_workers, sizeof(worker_t));
+
+    if (s_workers == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Split the jobs evenly, work stealing takes care of the imbalance
+       between short and long sounds */
+    for (unsigned w = 0; w < s_num_workers; w++) {
+        pthread_mutex_init(&s_workers[w].lock, NULL);
+        s_workers[w].begin = s_num_jobs * w / s_num_workers;
+        s_workers[w].end = s_num_jobs * (w + 1) / s_num_workers;
+    }
+
+    double const t0 = now();
+
+    for (unsigned w = 0; w < s_num_workers; w++) {
+        if (pthread_create(&s_workers[w].thread, NULL, worker_main, s_workers + w) != 0) {
+            fprintf(stderr, "Error creating thread\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    size_t files = 0, frames = 0, bytes = 0, failures = 0, steals = 0;
+
+    for (unsigned w = 0; w < s_num_workers; w++) {
+        worker_t* const worker = s_workers + w;
+        pthread_join(worker->thread, NULL);
+
+        files += worker->files;
+        frames += worker->frames;
+        bytes += worker->bytes;
+        failures += worker->failures;
+        steals += worker->steals;
+        free(worker->buffer);
+    }
+
+    double const elapsed = now() - t0;
+
+    /* Workers look at the locks of the others until they end */
+    for (unsigned w = 0; w < s_num_workers; w++) {
+        pthread_mutex_destroy(&s_workers[w].lock);
+    }
+
+    double const rate = elapsed > 0.0 ? 1.0 / elapsed : 0.0;
+
+    printf("%zu files, %zu frames, %.1f MiB in %.3f s with %u threads (%zu steals)\n",
+           files, frames, (double)bytes / (1024.0 * 1024.0), elapsed, s_num_workers, steals);
+
+    printf("%.1f files/s, %.0f frames/s\n", (double)files * rate, (double)frames * rate);
+
+    if (failures != 0) {
+        fprintf(stderr, "%zu files failed\n", failures);
+        res = -1;
+    }
+
+    for (size_t j = 0; j < s_num_jobs; j++) {
+        free(s_jobs[j].input);
+        free(s_jobs[j].output);
+    }
+
+    free(s_jobs);
+    free(s_workers);
+    return res == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
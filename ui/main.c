@@ -42,6 +42,7 @@ SOFTWARE.
 #define AL_SFXR_LOAD
 #define AL_SFXR_SAVE
 #define AL_SFXR_INT16_MONO
+#define AL_SFXR_MIXER
 #include <al_sfxr.h>
 /*---------------------------------------------------------------------------*/
 
@@ -77,7 +78,14 @@ static int s_mouse_left_click = 0, s_mouse_right_click = 0, s_mouse_middle_click
 
 static sfxr_params_t s_curparams, s_prevparams;
 static sfxr_params_t const* s_history = NULL;
-static al_sfxr_Decoder s_decoder = {0};
+
+/* The audio callback renders the mixer, and the UI only talks to it through
+   the queue */
+static al_sfxr_MixerVoice s_voices[1];
+static al_sfxr_PhaserLine s_lines[1];
+static al_sfxr_Mixer s_mixer;
+static al_sfxr_QueueSlot s_slots[16];
+static al_sfxr_Queue s_queue;
 
 static struct {char const* name; al_sfxr_Preset preset;} const s_categories[8] = {
     {"Pickup/Coin", AL_SFXR_PICKUP},
@@ -132,15 +140,13 @@ static void play_sample(void) {
         s_prevparams = s_curparams;
     }
 
-    al_sfxr_start_quick(&s_decoder, &s_curparams.params);
+    /* The mixer has only one voice, so the new sound replaces the playing one */
+    al_sfxr_Patch patch;
+    al_sfxr_compile(&patch, &s_curparams.params);
+    al_sfxr_queue_play(&s_queue, &patch, UINT64_C(0x89866ae81aa30a2b), 1.0f, 0);
     s_playing_sample = 1;
 }
 
-static int fpreader(void* const userdata, uint8_t* const byte) {
-    FILE* const fp = (FILE*)userdata;
-    return fread(byte, 1, 1, fp) != 1;
-}
-
 static void load_sound(void) {
     static char const* const extensions[1] = {
         "*.sfxr"
@@ -166,9 +172,13 @@ static void load_sound(void) {
         return;
     }
 
-    int const res = al_sfxr_load(&s_curparams.params, fpreader, fp);
+    /* .sfxr files are small, read them with a single call */
+    uint8_t data[256];
+    size_t const size = fread(data, 1, sizeof(data), fp);
     fclose(fp);
 
+    int const res = al_sfxr_load_mem(&s_curparams.params, data, size);
+
     if (res != 0) {
         fprintf(stderr, "Error loading \"%s\"\n", filename);
         return;
@@ -178,11 +188,6 @@ static void load_sound(void) {
     play_sample();
 }
 
-static int fpwriter(void* const userdata, uint8_t const byte) {
-    FILE* const fp = (FILE*)userdata;
-    return fwrite(&byte, 1, 1, fp) != 1;
-}
-
 static void save_sound(void) {
     static char const* const extensions[1] = {
         "*.sfxr"
@@ -207,7 +212,9 @@ static void save_sound(void) {
         return;
     }
 
-    int const res = al_sfxr_save(&s_curparams.params, fpwriter, fp);
+    uint8_t data[AL_SFXR_SAVE_SIZE];
+    size_t const size = al_sfxr_save_mem(&s_curparams.params, data, sizeof(data));
+    int const res = fwrite(data, 1, size, fp) != size;
     fclose(fp);
 
     if (res != 0) {
@@ -661,13 +668,16 @@ void draw_screen(void)
 static void audio_callback(void* const userdata, Uint8* const stream, int const len) {
     (void)userdata;
 
-    if (s_playing_sample) {
-        size_t const frames_written = al_sfxr_produce1i(&s_decoder, (int16_t*)stream, len / sizeof(int16_t));
-        size_t const bytes_written = frames_written * sizeof(int16_t);
+    al_sfxr_queue_drain(&s_queue);
 
-        if (bytes_written < (size_t)len) {
-            memset(stream + bytes_written, 0, (size_t)len - bytes_written);
-        }
+    int16_t* const samples = (int16_t*)stream;
+    size_t const num_samples = (size_t)len / sizeof(int16_t);
+
+    for (size_t i = 0; i < num_samples; i += 256) {
+        float block[256];
+        size_t const count = num_samples - i < 256 ? num_samples - i : 256;
+        al_sfxr_mixer_produce(&s_mixer, block, count);
+        al_sfxr_convert1i(samples + i, block, count);
     }
 }
 
@@ -732,6 +742,9 @@ error2:
 
     s_screen = SDL_CreateRGBSurface(0, 640, 480, 32, rmask, gmask, bmask, amask);
 
+    al_sfxr_mixer_init(&s_mixer, s_voices, 1, s_lines, 1);
+    al_sfxr_queue_init(&s_queue, &s_mixer, s_slots, 16, 0);
+
     SDL_AudioSpec des;
     des.freq = 44100;
     des.format = AUDIO_S16SYS;